@@ -0,0 +1,134 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+// Cycles per allocation and free of newlib malloc against the pool and arena
+// allocators of the runtime (sw/device/lib/runtime/allocator.h) for typical
+// small-object patterns. The sizes are kept small for the default 2 KiB heap.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "csr.h"
+#include "allocator.h"
+
+#define OBJ_SIZE     16
+#define N_BURST      32
+#define N_LIVE       8
+#define N_QUEUE_OPS  128
+#define N_FRAME      16
+#define N_FRAMES     4
+
+static uint8_t pool_buffer[N_BURST * OBJ_SIZE] __attribute__((aligned(ALLOCATOR_ALIGN)));
+static uint8_t arena_buffer[N_FRAME * 64] __attribute__((aligned(ALLOCATOR_ALIGN)));
+
+static void *objects[N_BURST];
+static pool_t pool;
+static arena_t arena;
+static uint32_t errors = 0;
+
+static inline uint32_t get_cycles(void) {
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+static void *use(void *block, uint32_t size) {
+    if (block == NULL) errors++;
+    else ((uint8_t *)block)[size - 1] = (uint8_t)size;
+    return block;
+}
+
+// the frame sizes cycle through 8 to 64 bytes
+static inline uint32_t frame_size(int i) {
+    return 8 + (i * 24) % 57;
+}
+
+// N_BURST allocations, then all the frees
+static uint32_t burst(int use_pool) {
+    uint32_t start = get_cycles();
+    for (int i = 0; i < N_BURST; i++) {
+        objects[i] = use(use_pool ? pool_alloc(&pool) : malloc(OBJ_SIZE), OBJ_SIZE);
+    }
+    for (int i = N_BURST - 1; i >= 0; i--) {
+        if (use_pool) pool_free(&pool, objects[i]);
+        else free(objects[i]);
+    }
+    return get_cycles() - start;
+}
+
+// N_LIVE objects alive, each operation frees the oldest and allocates a new one
+static uint32_t queue(int use_pool) {
+    uint32_t start = get_cycles();
+    for (int i = 0; i < N_LIVE; i++) {
+        objects[i] = use(use_pool ? pool_alloc(&pool) : malloc(OBJ_SIZE), OBJ_SIZE);
+    }
+    for (int i = 0; i < N_QUEUE_OPS; i++) {
+        void **slot = &objects[i % N_LIVE];
+        if (use_pool) pool_free(&pool, *slot);
+        else free(*slot);
+        *slot = use(use_pool ? pool_alloc(&pool) : malloc(OBJ_SIZE), OBJ_SIZE);
+    }
+    for (int i = 0; i < N_LIVE; i++) {
+        if (use_pool) pool_free(&pool, objects[i]);
+        else free(objects[i]);
+    }
+    return get_cycles() - start;
+}
+
+// N_FRAME allocations of different sizes freed together, N_FRAMES times
+static uint32_t frames(int use_arena) {
+    uint32_t start = get_cycles();
+    for (int f = 0; f < N_FRAMES; f++) {
+        for (int i = 0; i < N_FRAME; i++) {
+            uint32_t size = frame_size(i + f);
+            objects[i] = use(use_arena ? arena_alloc(&arena, size) : malloc(size), size);
+        }
+        if (use_arena) {
+            arena_reset(&arena);
+        } else {
+            for (int i = 0; i < N_FRAME; i++) free(objects[i]);
+        }
+    }
+    return get_cycles() - start;
+}
+
+static void report(const char *pattern, uint32_t ops, uint32_t malloc_cycles, uint32_t other_cycles, const char *other) {
+    printf("%-6s %4u ops  malloc/free %5u cycles/op  %s %5u cycles/op\n", pattern, (unsigned)ops,
+           (unsigned)(malloc_cycles / ops), other, (unsigned)(other_cycles / ops));
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t malloc_cycles, other_cycles;
+
+    //enable mcycle csr
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    if (!pool_init(&pool, pool_buffer, sizeof(pool_buffer), OBJ_SIZE)) {
+        printf("pool_init failed\n");
+        return EXIT_FAILURE;
+    }
+    arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+
+    // a first round so that malloc has taken its memory from _sbrk
+    burst(0);
+
+    malloc_cycles = burst(0);
+    other_cycles  = burst(1);
+    report("burst", 2 * N_BURST, malloc_cycles, other_cycles, "pool");
+
+    malloc_cycles = queue(0);
+    other_cycles  = queue(1);
+    report("queue", 2 * (N_LIVE + N_QUEUE_OPS), malloc_cycles, other_cycles, "pool");
+
+    malloc_cycles = frames(0);
+    other_cycles  = frames(1);
+    report("frame", N_FRAMES * N_FRAME, malloc_cycles, other_cycles, "arena");
+
+    if (pool.used != 0) errors++;
+    printf("pool peak %u of %u blocks, arena peak %u bytes\n", (unsigned)pool.peak,
+           (unsigned)pool_capacity(&pool), (unsigned)arena.peak);
+    printf("allocator benchmark finished with %u errors\n", (unsigned)errors);
+    return errors;
+}
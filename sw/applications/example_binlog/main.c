@@ -0,0 +1,51 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+// Cost of BINLOG against printf for the same trace line. The binary log is
+// rendered on the host with:
+//   python util/binlog_decode.py sw/build/main.elf <path to uart0.log>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "csr.h"
+#include "binlog.h"
+
+#define N_EVENTS 32
+
+static inline uint32_t get_cycles(void) {
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t start, binlog_cycles, printf_cycles, dropped;
+    uint32_t acc = 0;
+
+    binlog_init();
+
+    start = get_cycles();
+    for (int i = 0; i < N_EVENTS; i++) {
+        acc += i * i;
+        BINLOG("event %d: acc = %u (0x%08x)\n", i, acc, acc);
+    }
+    binlog_cycles = get_cycles() - start;
+
+    acc = 0;
+    start = get_cycles();
+    for (int i = 0; i < N_EVENTS; i++) {
+        acc += i * i;
+        printf("event %d: acc = %u (0x%08x)\n", i, (unsigned)acc, (unsigned)acc);
+    }
+    printf_cycles = get_cycles() - start;
+
+    BINLOG("%d events logged in %u cycles\n", N_EVENTS, binlog_cycles);
+    dropped = binlog_flush();
+
+    printf("\nBINLOG: %u cycles per event, printf: %u cycles per event, %u records dropped\n",
+           (unsigned)(binlog_cycles / N_EVENTS), (unsigned)(printf_cycles / N_EVENTS), (unsigned)dropped);
+    return dropped == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
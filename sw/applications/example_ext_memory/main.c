@@ -19,8 +19,11 @@ uint32_t  buffer_rnd_index[BUFF_LEN];
 #define CACHE_SIZE    4*1024
 #endif
 
+//must match the +ext_mem_size of the SystemC testbench
+#ifndef MEMORY_SIZE
 #define MEMORY_SIZE           32*1024
-#define MEMORY_ADDR_MASK       0x7FFF
+#endif
+#define MEMORY_ADDR_MASK       (MEMORY_SIZE-1)
 #define MEMORY_MAX_WORD_INDEX  (MEMORY_SIZE/4)
 
 int is_in_array(uint32_t number, uint32_t* array, int N ) {
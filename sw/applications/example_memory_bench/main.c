@@ -0,0 +1,150 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+// Cycles per byte of memcpy, memset, memcmp and memchr for several sizes and
+// alignments, next to a byte-at-a-time loop as reference. The routines are
+// newlib's by default and the word-wise ones of sw/device/lib/base/memory.c
+// when the app is built with MEMORY_ROUTINES=runtime: run it both ways, with
+// CPU=cv32e20 and CPU=cv32e40p, to compare them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "csr.h"
+#include "memory.h"
+#include "x-heep.h"
+
+#define MAX_SIZE 1024
+#define N_SIZES  6
+#define N_ALIGNS 4
+
+static const uint32_t sizes[N_SIZES] = {4, 16, 64, 128, 512, 1024};
+// destination and source offsets from a word boundary
+static const uint32_t aligns[N_ALIGNS][2] = {{0, 0}, {1, 1}, {0, 1}, {3, 2}};
+
+static uint8_t buffer_a[MAX_SIZE + 8] __attribute__((aligned(4)));
+static uint8_t buffer_b[MAX_SIZE + 8] __attribute__((aligned(4)));
+
+// the reference loops must stay byte loops
+#if defined(__GNUC__) && !defined(__clang__)
+#define BYTE_LOOP __attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+#else
+#define BYTE_LOOP __attribute__((noinline))
+#endif
+
+BYTE_LOOP void byte_memcpy(uint8_t *dest, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; ++i) dest[i] = src[i];
+}
+
+BYTE_LOOP void byte_memset(uint8_t *dest, uint8_t value, size_t len) {
+    for (size_t i = 0; i < len; ++i) dest[i] = value;
+}
+
+BYTE_LOOP int byte_memcmp(const uint8_t *lhs, const uint8_t *rhs, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (lhs[i] != rhs[i]) return lhs[i] < rhs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+BYTE_LOOP const uint8_t *byte_memchr(const uint8_t *ptr, uint8_t value, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (ptr[i] == value) return ptr + i;
+    }
+    return NULL;
+}
+
+static inline uint32_t get_cycles(void) {
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+static void fill_buffers(void) {
+    for (int i = 0; i < MAX_SIZE + 8; i++) {
+        buffer_a[i] = (uint8_t)(i * 7 + 1);
+        buffer_b[i] = 0;
+    }
+}
+
+// cycles per byte are printed in hundredths
+static void print_result(const char *name, uint32_t size, const uint32_t *align, uint32_t cycles, uint32_t ref_cycles) {
+    printf("%-6s %5u %u/%u %7u %5u.%02u %7u %5u.%02u\n", name, (unsigned)size, (unsigned)align[0], (unsigned)align[1],
+           (unsigned)cycles, (unsigned)(cycles / size), (unsigned)((cycles * 100 / size) % 100),
+           (unsigned)ref_cycles, (unsigned)(ref_cycles / size), (unsigned)((ref_cycles * 100 / size) % 100));
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t errors = 0;
+    uint32_t start, cycles, ref_cycles;
+
+    //enable mcycle csr
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+#if defined(HOST_BUILD)
+    printf("newlib memory routines\n");
+#else
+    printf("runtime memory routines\n");
+#endif
+    // d/s: destination/source offsets, loop: the byte-at-a-time reference
+    printf("func    size d/s  cycles      c/B    loop      c/B\n");
+
+    for (int a = 0; a < N_ALIGNS; a++) {
+        for (int s = 0; s < N_SIZES; s++) {
+            uint32_t size = sizes[s];
+            uint8_t *dest = buffer_b + aligns[a][0];
+            uint8_t *src  = buffer_a + aligns[a][1];
+
+            // memcpy
+            fill_buffers();
+            start = get_cycles();
+            memcpy(dest, src, size);
+            cycles = get_cycles() - start;
+            if (byte_memcmp(dest, src, size) != 0) errors++;
+            start = get_cycles();
+            byte_memcpy(dest, src, size);
+            ref_cycles = get_cycles() - start;
+            print_result("memcpy", size, aligns[a], cycles, ref_cycles);
+
+            // memset
+            start = get_cycles();
+            memset(dest, 0x5A, size);
+            cycles = get_cycles() - start;
+            for (uint32_t i = 0; i < size; i++) if (dest[i] != 0x5A) errors++;
+            start = get_cycles();
+            byte_memset(dest, 0x5A, size);
+            ref_cycles = get_cycles() - start;
+            print_result("memset", size, aligns[a], cycles, ref_cycles);
+
+            // memcmp of equal buffers but the last byte, the worst case
+            byte_memcpy(dest, src, size);
+            dest[size - 1] ^= 1;
+            start = get_cycles();
+            int cmp = memcmp(dest, src, size);
+            cycles = get_cycles() - start;
+            int ref_cmp = byte_memcmp(dest, src, size);
+            if ((cmp < 0) != (ref_cmp < 0) || (cmp == 0) != (ref_cmp == 0)) errors++;
+            start = get_cycles();
+            byte_memcmp(dest, src, size);
+            ref_cycles = get_cycles() - start;
+            print_result("memcmp", size, aligns[a], cycles, ref_cycles);
+
+            // memchr of the last byte, the worst case
+            byte_memset(dest, 0, size);
+            dest[size - 1] = 0xA5;
+            start = get_cycles();
+            const void *found = memchr(dest, 0xA5, size);
+            cycles = get_cycles() - start;
+            if (found != dest + size - 1) errors++;
+            start = get_cycles();
+            byte_memchr(dest, 0xA5, size);
+            ref_cycles = get_cycles() - start;
+            print_result("memchr", size, aligns[a], cycles, ref_cycles);
+        }
+    }
+
+    printf("memory benchmark finished with %u errors\n", (unsigned)errors);
+    return errors;
+}
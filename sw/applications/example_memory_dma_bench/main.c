@@ -0,0 +1,101 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+// Crossover of memcpy and memset between the CPU and the DMA offload of
+// dma_sdk_memory_offload: both are timed for growing sizes and the smallest
+// size from which the DMA is always faster is the threshold to use with this
+// configuration (CPU, bus, memory banks). The offload needs the runtime memory
+// routines: build it with MEMORY_ROUTINES=runtime.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "csr.h"
+#include "memory.h"
+#include "dma_sdk.h"
+#include "x-heep.h"
+
+#define MAX_SIZE 4096
+#define N_SIZES  10
+#define DMA_CHANNEL 0
+
+static const uint32_t sizes[N_SIZES] = {8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+static uint8_t buffer_src[MAX_SIZE] __attribute__((aligned(4)));
+static uint8_t buffer_dst[MAX_SIZE] __attribute__((aligned(4)));
+
+static inline uint32_t get_cycles(void) {
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+static uint32_t time_memcpy(uint32_t size, uint32_t *errors) {
+    uint32_t start, cycles;
+    for (uint32_t i = 0; i < size; i++) {
+        buffer_src[i] = (uint8_t)(i * 3 + size);
+        buffer_dst[i] = 0;
+    }
+    start = get_cycles();
+    memcpy(buffer_dst, buffer_src, size);
+    cycles = get_cycles() - start;
+    for (uint32_t i = 0; i < size; i++) if (buffer_dst[i] != buffer_src[i]) (*errors)++;
+    return cycles;
+}
+
+static uint32_t time_memset(uint32_t size, uint32_t *errors) {
+    uint32_t start, cycles;
+    start = get_cycles();
+    memset(buffer_dst, (int)size, size);
+    cycles = get_cycles() - start;
+    for (uint32_t i = 0; i < size; i++) if (buffer_dst[i] != (uint8_t)size) (*errors)++;
+    return cycles;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t errors = 0;
+    uint32_t cpu_copy[N_SIZES], dma_copy_cycles[N_SIZES], cpu_fill[N_SIZES], dma_fill_cycles[N_SIZES];
+    int copy_crossover = -1, fill_crossover = -1;
+
+#if defined(HOST_BUILD)
+    // newlib's memcpy and memset do not call the offload hooks
+    printf("Build the app with MEMORY_ROUTINES=runtime to measure the DMA offload\n");
+    return EXIT_SUCCESS;
+#endif
+
+    //enable mcycle csr
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    dma_sdk_init();
+
+    for (int s = 0; s < N_SIZES; s++) {
+        dma_sdk_memory_offload(DMA_CHANNEL, 0);
+        cpu_copy[s] = time_memcpy(sizes[s], &errors);
+        cpu_fill[s] = time_memset(sizes[s], &errors);
+
+        dma_sdk_memory_offload(DMA_CHANNEL, 1);
+        dma_copy_cycles[s] = time_memcpy(sizes[s], &errors);
+        dma_fill_cycles[s] = time_memset(sizes[s], &errors);
+    }
+    dma_sdk_memory_offload(DMA_CHANNEL, 0);
+
+    printf(" size  memcpy cpu   dma  memset cpu   dma\n");
+    for (int s = 0; s < N_SIZES; s++) {
+        printf("%5u  %10u %5u  %10u %5u\n", (unsigned)sizes[s], (unsigned)cpu_copy[s], (unsigned)dma_copy_cycles[s],
+               (unsigned)cpu_fill[s], (unsigned)dma_fill_cycles[s]);
+    }
+
+    // the crossover is the smallest size from which the DMA wins at every larger size
+    for (int s = N_SIZES - 1; s >= 0 && dma_copy_cycles[s] < cpu_copy[s]; s--) copy_crossover = s;
+    for (int s = N_SIZES - 1; s >= 0 && dma_fill_cycles[s] < cpu_fill[s]; s--) fill_crossover = s;
+
+    if (copy_crossover >= 0) printf("memcpy: use the DMA from %u bytes\n", (unsigned)sizes[copy_crossover]);
+    else printf("memcpy: the CPU is always faster up to %u bytes\n", (unsigned)MAX_SIZE);
+    if (fill_crossover >= 0) printf("memset: use the DMA from %u bytes\n", (unsigned)sizes[fill_crossover]);
+    else printf("memset: the CPU is always faster up to %u bytes\n", (unsigned)MAX_SIZE);
+
+    printf("memory DMA benchmark finished with %u errors\n", (unsigned)errors);
+    return errors;
+}
@@ -36,6 +36,7 @@ build/Makefile : CMakeLists.txt ${CMAKE_DIR}/riscv.cmake
 			-DLINKER:STRING=${LINKER} \
 			-DCOMPILER:STRING=${COMPILER} \
 			-DCOMPILER_PREFIX:STRING=${COMPILER_PREFIX} \
+			-DMEMORY_ROUTINES:STRING=${MEMORY_ROUTINES} \
 			-DVERBOSE:STRING=${VERBOSE} \
 		    ../ 
 
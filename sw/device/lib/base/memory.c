@@ -18,10 +18,104 @@ extern "C" {
 // This approach is used so that DIFs can depend on `memory.h`, but also be
 // built for host-side software.
 
+// The hooks are defined in every build so that the callers of
+// memory_set_offload link, they are only used by the device memcpy and memset.
+static memory_offload_copy_t memory_offload_copy = NULL;
+static memory_offload_fill_t memory_offload_fill = NULL;
+static size_t memory_offload_threshold = SIZE_MAX;
+
+void memory_set_offload(memory_offload_copy_t copy, memory_offload_fill_t fill,
+                        size_t threshold) {
+  memory_offload_copy = copy;
+  memory_offload_fill = fill;
+  memory_offload_threshold = threshold;
+}
+
 #if !defined(HOST_BUILD)
+// Word accesses to byte buffers, which may alias any other type.
+typedef uint32_t __attribute__((may_alias)) memory_word_t;
+
+enum {
+  kMemWordSize = sizeof(uint32_t),
+  kMemWordMask = sizeof(uint32_t) - 1,
+  // Below this length the byte loops are faster than aligning the buffers.
+  kMemWordMinLen = 2 * sizeof(uint32_t),
+  kMemWordOnes = 0x01010101,
+  kMemWordHighBits = 0x80808080,
+};
+
+static inline uintptr_t memory_misalignment(const void *ptr) {
+  return (uintptr_t)ptr & kMemWordMask;
+}
+
+// GCC could otherwise turn the copy and fill loops back into calls to memcpy
+// and memset, i.e. into infinite recursions.
+#if defined(__GNUC__) && !defined(__clang__)
+#define MEMORY_NO_LOOP_PATTERNS \
+  __attribute__((optimize("no-tree-loop-distribute-patterns")))
+#else
+#define MEMORY_NO_LOOP_PATTERNS
+#endif
+#endif  // !defined(HOST_BUILD)
+
+#if !defined(HOST_BUILD)
+MEMORY_NO_LOOP_PATTERNS
 void *memcpy(void *__restrict dest, const void *__restrict src, size_t len) {
   uint8_t *dest8 = (uint8_t *)dest;
-  uint8_t *src8 = (uint8_t *)src;
+  const uint8_t *src8 = (const uint8_t *)src;
+
+  if (len >= kMemWordMinLen) {
+    // Copy the head byte by byte until the destination is word aligned.
+    while (memory_misalignment(dest8) != 0) {
+      *dest8++ = *src8++;
+      --len;
+    }
+
+    memory_word_t *dest32 = (memory_word_t *)dest8;
+    uintptr_t shift = memory_misalignment(src8) * 8;
+
+    if (shift == 0) {
+      const memory_word_t *src32 = (const memory_word_t *)src8;
+      if (memory_offload_copy != NULL && len >= memory_offload_threshold) {
+        size_t words = len / kMemWordSize;
+        memory_offload_copy((void *)dest32, (const void *)src32, words);
+        dest32 += words;
+        src32 += words;
+        len -= words * kMemWordSize;
+      }
+      for (; len >= 4 * kMemWordSize; len -= 4 * kMemWordSize) {
+        uint32_t w0 = src32[0];
+        uint32_t w1 = src32[1];
+        uint32_t w2 = src32[2];
+        uint32_t w3 = src32[3];
+        dest32[0] = w0;
+        dest32[1] = w1;
+        dest32[2] = w2;
+        dest32[3] = w3;
+        dest32 += 4;
+        src32 += 4;
+      }
+      for (; len >= kMemWordSize; len -= kMemWordSize) {
+        *dest32++ = *src32++;
+      }
+      src8 = (const uint8_t *)src32;
+    } else {
+      // The source is read with aligned words, each destination word is made
+      // of the end of one source word and the start of the next one. Every
+      // word read holds at least one byte of the source.
+      const memory_word_t *src32 =
+          (const memory_word_t *)(src8 - memory_misalignment(src8));
+      uint32_t prev = *src32++;
+      for (; len >= kMemWordSize; len -= kMemWordSize) {
+        uint32_t next = *src32++;
+        *dest32++ = (prev >> shift) | (next << (32 - shift));
+        prev = next;
+        src8 += kMemWordSize;
+      }
+    }
+    dest8 = (uint8_t *)dest32;
+  }
+
   for (size_t i = 0; i < len; ++i) {
     dest8[i] = src8[i];
   }
@@ -30,9 +124,38 @@ void *memcpy(void *__restrict dest, const void *__restrict src, size_t len) {
 #endif  // !defined(HOST_BUILD)
 
 #if !defined(HOST_BUILD)
+MEMORY_NO_LOOP_PATTERNS
 void *memset(void *dest, int value, size_t len) {
   uint8_t *dest8 = (uint8_t *)dest;
   uint8_t value8 = (uint8_t)value;
+
+  if (len >= kMemWordMinLen) {
+    while (memory_misalignment(dest8) != 0) {
+      *dest8++ = value8;
+      --len;
+    }
+
+    uint32_t value32 = value8 * (uint32_t)kMemWordOnes;
+    memory_word_t *dest32 = (memory_word_t *)dest8;
+    if (memory_offload_fill != NULL && len >= memory_offload_threshold) {
+      size_t words = len / kMemWordSize;
+      memory_offload_fill((void *)dest32, value32, words);
+      dest32 += words;
+      len -= words * kMemWordSize;
+    }
+    for (; len >= 4 * kMemWordSize; len -= 4 * kMemWordSize) {
+      dest32[0] = value32;
+      dest32[1] = value32;
+      dest32[2] = value32;
+      dest32[3] = value32;
+      dest32 += 4;
+    }
+    for (; len >= kMemWordSize; len -= kMemWordSize) {
+      *dest32++ = value32;
+    }
+    dest8 = (uint8_t *)dest32;
+  }
+
   for (size_t i = 0; i < len; ++i) {
     dest8[i] = value8;
   }
@@ -50,6 +173,31 @@ enum {
 int memcmp(const void *lhs, const void *rhs, size_t len) {
   const uint8_t *lhs8 = (uint8_t *)lhs;
   const uint8_t *rhs8 = (uint8_t *)rhs;
+
+  // Equal words are skipped when both regions have the same alignment, the
+  // first different word is then compared byte by byte.
+  if (len >= kMemWordMinLen &&
+      memory_misalignment(lhs8) == memory_misalignment(rhs8)) {
+    while (memory_misalignment(lhs8) != 0) {
+      if (*lhs8 != *rhs8) {
+        break;
+      }
+      ++lhs8;
+      ++rhs8;
+      --len;
+    }
+    if (memory_misalignment(lhs8) == 0) {
+      const memory_word_t *lhs32 = (const memory_word_t *)lhs8;
+      const memory_word_t *rhs32 = (const memory_word_t *)rhs8;
+      for (; len >= kMemWordSize && *lhs32 == *rhs32; len -= kMemWordSize) {
+        ++lhs32;
+        ++rhs32;
+      }
+      lhs8 = (const uint8_t *)lhs32;
+      rhs8 = (const uint8_t *)rhs32;
+    }
+  }
+
   for (size_t i = 0; i < len; ++i) {
     if (lhs8[i] < rhs8[i]) {
       return kMemCmpLt;
@@ -65,6 +213,30 @@ int memcmp(const void *lhs, const void *rhs, size_t len) {
 void *memchr(const void *ptr, int value, size_t len) {
   uint8_t *ptr8 = (uint8_t *)ptr;
   uint8_t value8 = (uint8_t)value;
+
+  if (len >= kMemWordMinLen) {
+    while (memory_misalignment(ptr8) != 0) {
+      if (*ptr8 == value8) {
+        return ptr8;
+      }
+      ++ptr8;
+      --len;
+    }
+
+    // A word holds value8 if the word xor-ed with value8 in every byte has a
+    // zero byte; the byte scan below finds which one.
+    uint32_t value32 = value8 * (uint32_t)kMemWordOnes;
+    const memory_word_t *ptr32 = (const memory_word_t *)ptr8;
+    for (; len >= kMemWordSize; len -= kMemWordSize) {
+      uint32_t word = *ptr32 ^ value32;
+      if (((word - kMemWordOnes) & ~word & kMemWordHighBits) != 0) {
+        break;
+      }
+      ++ptr32;
+    }
+    ptr8 = (uint8_t *)ptr32;
+  }
+
   for (size_t i = 0; i < len; ++i) {
     if (ptr8[i] == value8) {
       return ptr8 + i;
@@ -160,6 +160,37 @@ int memcmp(const void *lhs, const void *rhs, size_t len);
  */
 void *memchr(const void *ptr, int value, size_t len);
 
+/**
+ * Copies `words` words between word-aligned, non-overlapping regions.
+ */
+typedef void (*memory_offload_copy_t)(void *dest, const void *src,
+                                      size_t words);
+
+/**
+ * Writes `value` to `words` words of a word-aligned region.
+ */
+typedef void (*memory_offload_fill_t)(void *dest, uint32_t value,
+                                      size_t words);
+
+/**
+ * Offload the word-aligned part of large `memcpy()` and `memset()` calls.
+ *
+ * From `threshold` bytes, `memcpy()` and `memset()` hand the words of the
+ * region to `copy` and `fill` (e.g. to a DMA channel) and only move the
+ * unaligned head and tail themselves. A `memcpy()` whose source and
+ * destination have different alignments is never offloaded.
+ *
+ * This is a device-only feature of the runtime routines, i.e. of apps built
+ * with MEMORY_ROUTINES=runtime; newlib's `memcpy()` and `memset()` ignore the
+ * hooks. It is disabled by default and with a NULL hook.
+ *
+ * @param copy the copy hook, or NULL to keep copying with the CPU.
+ * @param fill the fill hook, or NULL to keep filling with the CPU.
+ * @param threshold the minimum length, in bytes, of an offloaded call.
+ */
+void memory_set_offload(memory_offload_copy_t copy, memory_offload_fill_t fill,
+                        size_t threshold);
+
 /**
  * Search a region of memory for the last occurence of a particular byte value.
  *
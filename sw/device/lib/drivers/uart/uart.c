@@ -126,13 +126,47 @@ size_t uart_getchar(const uart_t *uart, uint8_t *data) {
 size_t uart_write(const uart_t *uart, const uint8_t *data, size_t len) {
   size_t total = len;
   while (len) {
-    uart_putchar(uart, *data);
-    data++;
-    len--;
+    size_t written = uart_write_nonblocking(uart, data, len);
+    data += written;
+    len -= written;
   }
+  uart_wait_tx_done(uart);
   return total;
 }
 
+/**
+ * Write to the UART TX FIFO until it is full.
+ */
+size_t uart_write_nonblocking(const uart_t *uart, const uint8_t *data, size_t len) {
+  size_t written = 0;
+  while (written < len && !uart_tx_full(uart)) {
+    uint32_t reg = bitfield_field32_write(0, UART_WDATA_WDATA_FIELD, data[written]);
+    mmio_region_write32(uart->base_addr, UART_WDATA_REG_OFFSET, reg);
+    written++;
+  }
+  return written;
+}
+
+void uart_wait_tx_done(const uart_t *uart) {
+  while (!uart_tx_idle(uart)) {
+  }
+}
+
+void uart_tx_watermark_intr_enable(const uart_t *uart, bool enable) {
+  uint32_t reg = mmio_region_read32(uart->base_addr, UART_FIFO_CTRL_REG_OFFSET);
+  reg = bitfield_field32_write(reg, UART_FIFO_CTRL_TXILVL_FIELD, UART_FIFO_CTRL_TXILVL_VALUE_TXLVL16);
+  mmio_region_write32(uart->base_addr, UART_FIFO_CTRL_REG_OFFSET, reg);
+
+  reg = mmio_region_read32(uart->base_addr, UART_INTR_ENABLE_REG_OFFSET);
+  reg = bitfield_bit32_write(reg, UART_INTR_ENABLE_TX_WATERMARK_BIT, enable);
+  mmio_region_write32(uart->base_addr, UART_INTR_ENABLE_REG_OFFSET, reg);
+}
+
+void uart_tx_watermark_intr_clear(const uart_t *uart) {
+  mmio_region_write32(uart->base_addr, UART_INTR_STATE_REG_OFFSET,
+                      1u << UART_INTR_STATE_TX_WATERMARK_BIT);
+}
+
 /**
  * Read `len` bytes from the UART RX FIFO.
  */
@@ -8,6 +8,7 @@
 #ifndef _DRIVERS_UART_H_
 #define _DRIVERS_UART_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -65,6 +66,37 @@ void uart_putchar(const uart_t *uart, uint8_t byte);
  */
 size_t uart_write(const uart_t *uart, const uint8_t *data, size_t len);
 
+/**
+ * Write a buffer to the UART without waiting.
+ * Writes to the TX FIFO until it is full and returns without waiting for the
+ * transmission.
+ * @param uart Pointer to uart_t represting the target UART.
+ * @param data Pointer to buffer to write.
+ * @param len Length of the buffer to write.
+ * @return Number of bytes written, less than len if the TX FIFO got full.
+ */
+size_t uart_write_nonblocking(const uart_t *uart, const uint8_t *data, size_t len);
+
+/**
+ * Wait until the TX FIFO is empty and the last byte has been transmitted.
+ * @param uart Pointer to uart_t represting the target UART.
+ */
+void uart_wait_tx_done(const uart_t *uart);
+
+/**
+ * Enable or disable the TX watermark interrupt.
+ * The interrupt is raised when the TX FIFO drops below 16 bytes.
+ * @param uart Pointer to uart_t represting the target UART.
+ * @param enable Whether the interrupt is enabled.
+ */
+void uart_tx_watermark_intr_enable(const uart_t *uart, bool enable);
+
+/**
+ * Clear a pending TX watermark interrupt.
+ * @param uart Pointer to uart_t represting the target UART.
+ */
+void uart_tx_watermark_intr_clear(const uart_t *uart);
+
 /**
  * Sink a buffer to the UART.
  *
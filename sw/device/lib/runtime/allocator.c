@@ -0,0 +1,108 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+#include "allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ALLOCATOR_ROUND_UP(size) (((size) + ALLOCATOR_ALIGN - 1) & ~(size_t)(ALLOCATOR_ALIGN - 1))
+
+bool pool_init(pool_t *pool, void *buffer, size_t size, size_t block_size)
+{
+    // sizes are compared before rounding up, which would wrap around near SIZE_MAX
+    if (size < block_size) return false;
+    block_size = ALLOCATOR_ROUND_UP(block_size == 0 ? 1 : block_size);
+    if (((uintptr_t)buffer & (ALLOCATOR_ALIGN - 1)) != 0 || size < block_size) return false;
+
+    pool->free_list  = NULL;
+    pool->start      = (uint8_t *)buffer;
+    pool->next       = pool->start;
+    pool->end        = pool->start + size / block_size * block_size;
+    pool->block_size = block_size;
+    pool->used       = 0;
+    pool->peak       = 0;
+    return true;
+}
+
+void *pool_alloc(pool_t *pool)
+{
+    void *block;
+
+    if (pool->free_list != NULL) {
+        block           = pool->free_list;
+        pool->free_list = *(void **)block;
+    } else if (pool->next < pool->end) {
+        block       = pool->next;
+        pool->next += pool->block_size;
+    } else {
+        return NULL;
+    }
+
+    if (++pool->used > pool->peak) pool->peak = pool->used;
+    return block;
+}
+
+void pool_free(pool_t *pool, void *block)
+{
+    if (block == NULL) return;
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+    pool->used--;
+}
+
+bool pool_owns(const pool_t *pool, const void *ptr)
+{
+    return (const uint8_t *)ptr >= pool->start && (const uint8_t *)ptr < pool->end;
+}
+
+size_t pool_capacity(const pool_t *pool)
+{
+    return (size_t)(pool->end - pool->start) / pool->block_size;
+}
+
+void arena_init(arena_t *arena, void *buffer, size_t size)
+{
+    uint8_t *start = (uint8_t *)ALLOCATOR_ROUND_UP((uintptr_t)buffer);
+
+    arena->start = start;
+    arena->top   = start;
+    arena->end   = (uint8_t *)buffer + size < start ? start : (uint8_t *)buffer + size;
+    arena->peak  = 0;
+}
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    uint8_t *block = arena->top;
+    size_t left = arena->end - block;
+
+    // sizes are compared before rounding up, which would wrap around near SIZE_MAX
+    if (size > left) return NULL;
+    size = ALLOCATOR_ROUND_UP(size);
+    if (size > left) return NULL;
+
+    arena->top = block + size;
+    if ((size_t)(arena->top - arena->start) > arena->peak) arena->peak = arena->top - arena->start;
+    return block;
+}
+
+size_t arena_mark(const arena_t *arena)
+{
+    return arena->top - arena->start;
+}
+
+void arena_reset_to(arena_t *arena, size_t mark)
+{
+    if (mark <= (size_t)(arena->top - arena->start)) arena->top = arena->start + mark;
+}
+
+void arena_reset(arena_t *arena)
+{
+    arena->top = arena->start;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,138 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+#ifndef _RUNTIME_ALLOCATOR_H_
+#define _RUNTIME_ALLOCATOR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocators on a buffer given by the application (a static array, or one
+ * block taken from malloc at start-up), as an alternative to newlib malloc for
+ * the objects created and destroyed at run time:
+ *
+ * - a pool hands out blocks of one size, alloc and free are O(1) and the
+ *   pool cannot fragment;
+ * - an arena hands out blocks of any size one after the other and frees them
+ *   all at once with arena_reset (or back to an arena_mark), e.g. per frame.
+ *
+ * Blocks are aligned to ALLOCATOR_ALIGN bytes like malloc. The allocators are
+ * not protected against interrupts: a pool or arena used from an interrupt
+ * handler must not be used elsewhere.
+ */
+
+#define ALLOCATOR_ALIGN 8
+
+typedef struct pool {
+    void    *free_list;  // blocks given back, linked through their first word
+    uint8_t *next;       // blocks never handed out start here
+    uint8_t *start;
+    uint8_t *end;
+    size_t   block_size;
+    size_t   used;       // blocks handed out
+    size_t   peak;
+} pool_t;
+
+typedef struct arena {
+    uint8_t *start;
+    uint8_t *top;
+    uint8_t *end;
+    size_t   peak;       // bytes
+} arena_t;
+
+/**
+ * Initialise a pool of blocks of block_size bytes on a buffer.
+ * The buffer is not touched until blocks are allocated, so this is O(1).
+ * @param pool       Pool to initialise.
+ * @param buffer     Memory of the blocks, aligned to ALLOCATOR_ALIGN.
+ * @param size       Size of the buffer in bytes.
+ * @param block_size Size of the blocks, rounded up to ALLOCATOR_ALIGN.
+ * @return false if the buffer is misaligned or smaller than one block.
+ */
+bool pool_init(pool_t *pool, void *buffer, size_t size, size_t block_size);
+
+/**
+ * @return A block, or NULL if the pool is exhausted.
+ */
+void *pool_alloc(pool_t *pool);
+
+/**
+ * Give back a block of the pool, NULL is ignored.
+ */
+void pool_free(pool_t *pool, void *block);
+
+/**
+ * @return Whether ptr is in the buffer of the pool.
+ */
+bool pool_owns(const pool_t *pool, const void *ptr);
+
+/**
+ * @return Number of blocks of the pool.
+ */
+size_t pool_capacity(const pool_t *pool);
+
+/**
+ * Initialise an arena on a buffer.
+ * @param arena  Arena to initialise.
+ * @param buffer Memory of the arena.
+ * @param size   Size of the buffer in bytes.
+ */
+void arena_init(arena_t *arena, void *buffer, size_t size);
+
+/**
+ * @return size bytes aligned to ALLOCATOR_ALIGN, or NULL if the arena is full.
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @return The current top of the arena, for arena_reset_to.
+ */
+size_t arena_mark(const arena_t *arena);
+
+/**
+ * Free everything allocated after the mark was taken.
+ */
+void arena_reset_to(arena_t *arena, size_t mark);
+
+/**
+ * Free everything allocated in the arena.
+ */
+void arena_reset(arena_t *arena);
+
+#ifdef __cplusplus
+}
+
+#include <new>
+
+// Objects in a pool or an arena, e.g. new (pool) T(...), defined in heap.cpp.
+// They return nullptr when the allocator is full or the object does not fit
+// in a block of the pool.
+void *operator new(size_t size, pool_t &pool) noexcept;
+void *operator new(size_t size, arena_t &arena) noexcept;
+void *operator new[](size_t size, arena_t &arena) noexcept;
+// only called if a constructor throws
+void operator delete(void *p, pool_t &pool) noexcept;
+void operator delete(void *p, arena_t &arena) noexcept;
+void operator delete[](void *p, arena_t &arena) noexcept;
+
+// Destroys an object created with new (pool) and gives back its block.
+// Objects in an arena are freed with arena_reset, after calling their
+// destructors if they have any.
+template <typename T>
+void pool_delete(pool_t &pool, T *object)
+{
+    if (object == nullptr) return;
+    object->~T();
+    pool_free(&pool, object);
+}
+
+#endif  // __cplusplus
+
+#endif  // _RUNTIME_ALLOCATOR_H_
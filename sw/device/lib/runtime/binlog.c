@@ -0,0 +1,99 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "binlog.h"
+#include "csr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (BINLOG_BUFFER_WORDS & (BINLOG_BUFFER_WORDS - 1)) != 0
+#error "BINLOG_BUFFER_WORDS must be a power of 2"
+#endif
+
+// head and tail are free running, the buffer holds head - tail words
+static uint32_t binlog_buffer[BINLOG_BUFFER_WORDS];
+static volatile uint32_t binlog_head = 0;
+static volatile uint32_t binlog_tail = 0;
+static volatile uint32_t binlog_dropped = 0;
+
+void binlog_init(void)
+{
+    binlog_head    = 0;
+    binlog_tail    = 0;
+    binlog_dropped = 0;
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+}
+
+void binlog_write(uint32_t id, uint32_t nargs, ...)
+{
+    uint32_t mstatus, cycles;
+    va_list args;
+
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+
+    // interrupt handlers may log too
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    uint32_t head = binlog_head;
+    if (BINLOG_BUFFER_WORDS - (head - binlog_tail) < nargs + 2) {
+        binlog_dropped++;
+    } else {
+        binlog_buffer[head++ % BINLOG_BUFFER_WORDS] = BINLOG_HEADER(id, nargs);
+        binlog_buffer[head++ % BINLOG_BUFFER_WORDS] = cycles;
+        va_start(args, nargs);
+        for (uint32_t i = 0; i < nargs; i++) {
+            binlog_buffer[head++ % BINLOG_BUFFER_WORDS] = va_arg(args, uint32_t);
+        }
+        va_end(args);
+        binlog_head = head;
+    }
+
+    if (mstatus & 0x8) CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+}
+
+uint32_t binlog_flush(void)
+{
+    uint32_t mstatus, frame[3];
+
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+    uint32_t head    = binlog_head;
+    uint32_t tail    = binlog_tail;
+    uint32_t dropped = binlog_dropped;
+    binlog_dropped   = 0;
+    if (mstatus & 0x8) CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    if (head == tail && dropped == 0) return 0;
+
+    // text printed before stays before the frame
+    fflush(stdout);
+
+    frame[0] = BINLOG_FRAME_SYNC;
+    frame[1] = head - tail;
+    frame[2] = dropped;
+    write(STDOUT_FILENO, frame, sizeof(frame));
+
+    // the records are only written by binlog_write, until the tail moves
+    uint32_t start = tail % BINLOG_BUFFER_WORDS;
+    uint32_t n     = head - tail;
+    if (n > BINLOG_BUFFER_WORDS - start) {
+        write(STDOUT_FILENO, &binlog_buffer[start], (BINLOG_BUFFER_WORDS - start) * sizeof(uint32_t));
+        n    -= BINLOG_BUFFER_WORDS - start;
+        start = 0;
+    }
+    write(STDOUT_FILENO, &binlog_buffer[start], n * sizeof(uint32_t));
+
+    binlog_tail = head;
+    return dropped;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,75 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+#ifndef _RUNTIME_BINLOG_H_
+#define _RUNTIME_BINLOG_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Deferred binary log.
+ *
+ * BINLOG("x = %d, y = %x\n", x, y) does not format anything: it appends to a
+ * RAM ring buffer the ID of the format string, the mcycle counter and the
+ * arguments, a few words in a few tens of cycles. The format strings are kept
+ * in the .binlog_fmt section of the ELF, which is not loaded on the device, and
+ * their ID is their offset in the section. binlog_flush() sends the buffer to
+ * stdout in binary frames and util/binlog_decode.py renders them with the ELF.
+ *
+ * Arguments must be 32-bit integers or pointers (%d %i %u %x %X %o %c %p, and
+ * %s for strings in the ELF), at most BINLOG_MAX_ARGS of them. BINLOG can be
+ * used from interrupt handlers; when the buffer is full the records are dropped
+ * and counted.
+ */
+
+#ifndef BINLOG_BUFFER_WORDS
+#define BINLOG_BUFFER_WORDS 1024
+#endif
+
+#define BINLOG_MAX_ARGS 6
+
+// a record is the header, the timestamp and the arguments
+#define BINLOG_HEADER(id, nargs) (((uint32_t)(nargs) << 28) | ((uint32_t)(id) & 0x0FFFFFFF))
+
+// frames sent by binlog_flush: the sync word, the number of record words, the
+// number of records dropped since the previous frame, the record words
+#define BINLOG_FRAME_SYNC 0x474C42B1  // "\xB1BLG" in memory
+
+#define BINLOG_NARGS_(_fmt, _1, _2, _3, _4, _5, _6, n, ...) n
+#define BINLOG_NARGS(...) BINLOG_NARGS_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+
+#define BINLOG(fmt, ...)                                                                                \
+    do {                                                                                                \
+        static const char binlog_fmt[] __attribute__((section(".binlog_fmt"), used)) = fmt;             \
+        binlog_write((uint32_t)(uintptr_t)binlog_fmt, BINLOG_NARGS(fmt, ##__VA_ARGS__), ##__VA_ARGS__); \
+    } while (0)
+
+/**
+ * Empty the buffer and start the mcycle counter used for the timestamps.
+ */
+void binlog_init(void);
+
+/**
+ * Append a record, use BINLOG instead.
+ * @param id    Offset of the format string in .binlog_fmt.
+ * @param nargs Number of 32-bit arguments that follow.
+ */
+void binlog_write(uint32_t id, uint32_t nargs, ...);
+
+/**
+ * Send the records in the buffer to stdout in one frame and remove them.
+ * Records written meanwhile (e.g. by interrupt handlers) stay for the next flush.
+ * @return Number of records dropped since the previous flush because the buffer was full.
+ */
+uint32_t binlog_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _RUNTIME_BINLOG_H_
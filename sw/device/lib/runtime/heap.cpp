@@ -18,6 +18,7 @@
 
 #include <cstdlib>
 #include <new>
+#include "allocator.h"
 
 void* operator new(size_t size) noexcept
 {
@@ -57,4 +58,36 @@ void* operator new[](size_t size, std::nothrow_t) noexcept
 void operator delete[](void *p,  std::nothrow_t) noexcept
 {
     operator delete(p); // Same as regular delete
-}
\ No newline at end of file
+}
+
+// Objects in the pools and arenas of allocator.h
+
+void* operator new(size_t size, pool_t &pool) noexcept
+{
+    return size <= pool.block_size ? pool_alloc(&pool) : nullptr;
+}
+
+void* operator new(size_t size, arena_t &arena) noexcept
+{
+    return arena_alloc(&arena, size);
+}
+
+void* operator new[](size_t size, arena_t &arena) noexcept
+{
+    return arena_alloc(&arena, size);
+}
+
+void operator delete(void *p, pool_t &pool) noexcept
+{
+    pool_free(&pool, p);
+}
+
+void operator delete(void *, arena_t &) noexcept
+{
+    // freed with the arena
+}
+
+void operator delete[](void *, arena_t &) noexcept
+{
+    // freed with the arena
+}
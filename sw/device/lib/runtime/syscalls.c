@@ -30,9 +30,12 @@ extern "C" {
 #include <errno.h>
 #include "uart.h"
 #include "soc_ctrl.h"
+#include "rv_plic.h"
+#include "csr.h"
 #include "core_v_mini_mcu.h"
 #include "error.h"
 #include "x-heep.h"
+#include "syscalls.h"
 #include <stdio.h>
 
 #undef errno
@@ -40,6 +43,14 @@ extern int errno;
 
 #define STDOUT_FILENO 1
 
+#ifndef STDOUT_BUFFER_SIZE
+#define STDOUT_BUFFER_SIZE 256
+#endif
+
+#if (STDOUT_BUFFER_SIZE & (STDOUT_BUFFER_SIZE - 1)) != 0
+#error "STDOUT_BUFFER_SIZE must be a power of 2"
+#endif
+
 #ifndef _LIBC
 /* Provide prototypes for most of the _<systemcall> names that are
    provided in newlib for some compilers.  */
@@ -106,8 +117,13 @@ int _execve(const char *name, char *const argv[], char *const env[])
     return -1;
 }
 
+static void stdout_drain_all(void);
+
 void _exit(int exit_status)
 {
+    // the simulation stops at exit, the UART must be done by then
+    stdout_drain_all();
+
     soc_ctrl_t soc_ctrl;
     soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
     soc_ctrl_set_exit_value(&soc_ctrl, exit_status);
@@ -246,28 +262,164 @@ int _wait(int *status)
     return -1;
 }
 
+// UART of stdout, initialised on the first write and again when the clock frequency changes
+static uart_t stdout_uart;
+static bool stdout_uart_ready = false;
+static bool stdout_use_interrupt = false;
+// state of the TX watermark interrupt enable, only written when it changes
+static bool stdout_tx_intr_enabled = false;
+
+// bytes waiting for the TX FIFO when stdout is sent with the interrupt,
+// head and tail are free running, the ring holds head - tail bytes
+static uint8_t stdout_buffer[STDOUT_BUFFER_SIZE];
+static volatile size_t stdout_head = 0;
+static volatile size_t stdout_tail = 0;
+
+static uint32_t stdout_get_frequency(void)
+{
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+    return soc_ctrl_get_frequency(&soc_ctrl);
+}
+
+static bool stdout_uart_init(void)
+{
+    stdout_uart.base_addr   = mmio_region_from_addr((uintptr_t)UART_START_ADDRESS);
+    stdout_uart.baudrate    = UART_BAUDRATE;
+    stdout_uart.clk_freq_hz = stdout_get_frequency();
+
+    // uart_init disables the UART interrupts
+    stdout_tx_intr_enabled = false;
+    stdout_uart_ready = uart_init(&stdout_uart) == kErrorOk;
+    return stdout_uart_ready;
+}
+
+// the ring is shared with the interrupt handler
+static uint32_t stdout_lock(void)
+{
+    uint32_t mstatus;
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+    return mstatus;
+}
+
+static void stdout_unlock(uint32_t mstatus)
+{
+    if (mstatus & 0x8) CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+}
+
+// Moves the ring to the TX FIFO until one of them is empty or full. If bytes
+// are left, the FIFO is full and the watermark interrupt will come when it
+// drops below 16 bytes.
+static void stdout_drain(void)
+{
+    while (stdout_head != stdout_tail) {
+        size_t start = stdout_tail % STDOUT_BUFFER_SIZE;
+        size_t n     = stdout_head - stdout_tail;
+        if (n > STDOUT_BUFFER_SIZE - start) n = STDOUT_BUFFER_SIZE - start;
+
+        size_t written = uart_write_nonblocking(&stdout_uart, &stdout_buffer[start], n);
+        stdout_tail += written;
+        if (written < n) break;
+    }
+
+    // the interrupt enable is a read-modify-write, only done when the ring becomes empty or not
+    bool pending = stdout_use_interrupt && stdout_head != stdout_tail;
+    if (pending != stdout_tx_intr_enabled) {
+        uart_tx_watermark_intr_enable(&stdout_uart, pending);
+        stdout_tx_intr_enabled = pending;
+    }
+}
+
+static void stdout_tx_handler(uint32_t id)
+{
+    uart_tx_watermark_intr_clear(&stdout_uart);
+    stdout_drain();
+}
+
+static void stdout_drain_all(void)
+{
+    if (!stdout_uart_ready) return;
+    while (stdout_head != stdout_tail) {
+        uint32_t mstatus = stdout_lock();
+        stdout_drain();
+        stdout_unlock(mstatus);
+    }
+    uart_wait_tx_done(&stdout_uart);
+}
+
+void stdout_flush(void)
+{
+    fflush(stdout);
+    stdout_drain_all();
+}
+
+void stdout_set_interrupt(bool enable)
+{
+    if (enable) {
+        plic_assign_external_irq_handler(UART_INTR_TX_WATERMARK, (void *)&stdout_tx_handler);
+        plic_irq_set_priority(UART_INTR_TX_WATERMARK, 1);
+        plic_irq_set_enabled(UART_INTR_TX_WATERMARK, kPlicToggleEnabled);
+    } else {
+        stdout_flush();
+        plic_irq_set_enabled(UART_INTR_TX_WATERMARK, kPlicToggleDisabled);
+    }
+    stdout_use_interrupt = enable;
+}
+
+void stdout_reinit(void)
+{
+    stdout_flush();
+    stdout_uart_init();
+}
+
 ssize_t _write(int file, const void *ptr, size_t len)
 {
+    const uint8_t *data = (const uint8_t *)ptr;
+    size_t left = len;
+
     if (file != STDOUT_FILENO) {
         errno = ENOSYS;
         return -1;
     }
 
-    soc_ctrl_t soc_ctrl;
-    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
-
-    uart_t uart;
-    uart.base_addr   = mmio_region_from_addr((uintptr_t)UART_START_ADDRESS);
-    uart.baudrate    = UART_BAUDRATE;
-    uart.clk_freq_hz = soc_ctrl_get_frequency(&soc_ctrl);
+    // a single register read detects a frequency change (soc_ctrl_set_frequency),
+    // the bytes already queued are sent first with the previous divider
+    if (stdout_uart_ready && stdout_get_frequency() != stdout_uart.clk_freq_hz) {
+        stdout_drain_all();
+        stdout_uart_ready = false;
+    }
 
-    if (uart_init(&uart) != kErrorOk) {
+    if (!stdout_uart_ready && !stdout_uart_init()) {
         errno = ENOSYS;
         return -1;
     }
-    return uart_write(&uart,(uint8_t *)ptr,len);
-}
 
+    if (!stdout_use_interrupt) {
+        while (left > 0) {
+            size_t written = uart_write_nonblocking(&stdout_uart, data, left);
+            data += written;
+            left -= written;
+        }
+        return len;
+    }
+
+    // when the ring is full this loops until the FIFO takes some bytes
+    while (left > 0) {
+        uint32_t mstatus = stdout_lock();
+        size_t n = STDOUT_BUFFER_SIZE - (stdout_head - stdout_tail);
+        if (n > left) n = left;
+        for (size_t i = 0; i < n; i++) {
+            stdout_buffer[(stdout_head + i) % STDOUT_BUFFER_SIZE] = data[i];
+        }
+        stdout_head += n;
+        data += n;
+        left -= n;
+        stdout_drain();
+        stdout_unlock(mstatus);
+    }
+    return len;
+}
 
 _ssize_t _write_r(struct _reent *ptr, int fd, const void *buf, size_t cnt)
 {
@@ -0,0 +1,50 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+#ifndef _RUNTIME_SYSCALLS_H_
+#define _RUNTIME_SYSCALLS_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * stdout (printf, puts, ...) is written to the UART, which is initialised on
+ * the first write. Every write compares the SoC frequency with the one the
+ * UART was initialised for and initialises it again after a change made with
+ * soc_ctrl_set_frequency. By default _write returns as soon as the last byte is in the
+ * 32-byte TX FIFO and only waits while the FIFO is full. With the interrupt
+ * enabled, the bytes that do not fit in the FIFO are queued in a ring buffer of
+ * STDOUT_BUFFER_SIZE bytes and moved to the FIFO by the TX watermark interrupt;
+ * _write only waits when the ring buffer is full. stdout is flushed by _exit.
+ */
+
+/**
+ * Wait until everything written to stdout has been transmitted.
+ */
+void stdout_flush(void);
+
+/**
+ * Send stdout in the background with the UART TX watermark interrupt.
+ * Must be called after plic_Init, with the machine external interrupts enabled
+ * (MIE bit 11 and MSTATUS.MIE), otherwise _write falls back to waiting.
+ * @param enable Whether stdout is sent with the interrupt.
+ */
+void stdout_set_interrupt(bool enable);
+
+/**
+ * Initialise the UART again for the current clock frequency, it flushes stdout
+ * first. The next write does it anyway after soc_ctrl_set_frequency. Call
+ * stdout_flush before changing the clock: the bytes still queued are otherwise
+ * sent with the divider of the previous frequency.
+ */
+void stdout_reinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _RUNTIME_SYSCALLS_H_
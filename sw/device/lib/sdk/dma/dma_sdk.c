@@ -14,6 +14,7 @@
 #include "fast_intr_ctrl.h"
 #include "core_v_mini_mcu.h"
 #include "csr.h"
+#include "memory.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -26,6 +27,8 @@ extern "C"
 
     volatile uint8_t dma_sdk_intr_flag;
 
+    static uint8_t dma_sdk_offload_channel;
+
 #define DMA_REGISTER_SIZE_BYTES sizeof(int)
 #define DMA_SELECTION_OFFSET_START 0
 
@@ -104,6 +107,60 @@ extern "C"
         return;
     }
 
+    // memcpy and memset may be called with the interrupts disabled, which
+    // DMA_WAIT would enable again: MSTATUS.MIE is left as it was.
+    static void dma_sdk_offload_wait(void)
+    {
+        uint32_t mstatus;
+        CSR_READ(CSR_REG_MSTATUS, &mstatus);
+        if (mstatus & 0x8)
+        {
+            DMA_WAIT(dma_sdk_offload_channel);
+        }
+        else
+        {
+            while (!dma_is_ready(dma_sdk_offload_channel))
+            {
+                wait_for_interrupt();
+            }
+        }
+    }
+
+    // A transaction moves at most DMA_SIZE_D1_SIZE_MASK elements
+    static void dma_sdk_offload_copy(void *dest, const void *src, size_t words)
+    {
+        while (words > 0)
+        {
+            uint32_t chunk = words > DMA_SIZE_D1_SIZE_MASK ? DMA_SIZE_D1_SIZE_MASK : words;
+            dma_copy_async((uint32_t)dest, (uint32_t)src, chunk, dma_sdk_offload_channel, DMA_DATA_TYPE_WORD, DMA_DATA_TYPE_WORD, 0);
+            dma_sdk_offload_wait();
+            dest = (uint32_t *)dest + chunk;
+            src = (const uint32_t *)src + chunk;
+            words -= chunk;
+        }
+    }
+
+    static void dma_sdk_offload_fill(void *dest, uint32_t value, size_t words)
+    {
+        while (words > 0)
+        {
+            uint32_t chunk = words > DMA_SIZE_D1_SIZE_MASK ? DMA_SIZE_D1_SIZE_MASK : words;
+            dma_fill_async((uint32_t)dest, (uint32_t)&value, chunk, dma_sdk_offload_channel, DMA_DATA_TYPE_WORD, DMA_DATA_TYPE_WORD, 0);
+            dma_sdk_offload_wait();
+            dest = (uint32_t *)dest + chunk;
+            words -= chunk;
+        }
+    }
+
+    void dma_sdk_memory_offload(uint8_t channel, uint32_t threshold)
+    {
+        dma_sdk_offload_channel = channel;
+        if (threshold == 0)
+            memory_set_offload(NULL, NULL, SIZE_MAX);
+        else
+            memory_set_offload(dma_sdk_offload_copy, dma_sdk_offload_fill, threshold);
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -120,6 +120,22 @@ extern "C"
 
     void __attribute__((noinline)) dma_wait(uint8_t channel);
 
+    /**
+     * @brief Offloads large memcpy and memset calls to a DMA channel.
+     *
+     * From threshold bytes, the word-aligned part of memcpy and memset is moved
+     * by the DMA, while the CPU handles the unaligned head and tail. The channel
+     * is reserved: it must not be used by the application meanwhile, nor must
+     * memcpy or memset be called from interrupt handlers. dma_sdk_init must be
+     * called first. Only the runtime memcpy and memset are offloaded, i.e. the
+     * app must be built with MEMORY_ROUTINES=runtime. Use
+     * example_memory_dma_bench to choose the threshold.
+     *
+     * @param channel   DMA channel used for memcpy and memset.
+     * @param threshold Minimum size in bytes of an offloaded call, 0 disables the offload.
+     */
+    void dma_sdk_memory_offload(uint8_t channel, uint32_t threshold);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
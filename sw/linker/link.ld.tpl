@@ -303,6 +303,10 @@ SECTIONS
 % endif
 % endfor
 
+  /* format strings of the binary log (binlog.h), kept in the ELF for the host
+     decoder but not loaded: the address of a string is its offset */
+  .binlog_fmt    0 (INFO) : { KEEP (*(.binlog_fmt)) }
+
   /* Stabs debugging sections.  */
   .stab          0 : { *(.stab) }
   .stabstr       0 : { *(.stabstr) }
@@ -117,4 +117,7 @@ SECTIONS {
    PROVIDE(__stack_end = .);
    PROVIDE(__freertos_irq_stack_top = .);
   } >RAM
+
+  /* binary log format strings, not loaded (see link.ld.tpl) */
+  .binlog_fmt    0 (INFO) : { KEEP (*(.binlog_fmt)) }
 }
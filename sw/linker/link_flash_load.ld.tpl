@@ -183,4 +183,6 @@ SECTIONS {
         . = ALIGN(4);
     } >FLASH_left
 
+  /* binary log format strings, not loaded (see link.ld.tpl) */
+  .binlog_fmt    0 (INFO) : { KEEP (*(.binlog_fmt)) }
 }
@@ -24,6 +24,15 @@ std::string XHEEP_CmdLineOptions::getCmdOption(int argc, char* argv[], const std
      return cmd;
 }
 
+bool XHEEP_CmdLineOptions::hasCmdFlag(int argc, char* argv[], const std::string& flag)
+{
+     for( int i = 0; i < argc; ++i)
+     {
+          if(flag.compare(argv[i]) == 0) return true;
+     }
+     return false;
+}
+
 bool XHEEP_CmdLineOptions::get_use_openocd()
 {
 
@@ -98,3 +107,193 @@ unsigned int XHEEP_CmdLineOptions::get_boot_sel()
 
   return boot_sel;
 }
+
+unsigned int XHEEP_CmdLineOptions::get_exit_check_interval()
+{
+  std::string arg_exit_check = this->getCmdOption(this->argc, this->argv, "+exit_check_interval=");
+  // 250 cycles, the 500 half cycles the run-all loop always ran between two checks
+  unsigned int exit_check_interval = 250;
+
+  if(!arg_exit_check.empty()) {
+    exit_check_interval = stoul(arg_exit_check);
+    if(exit_check_interval == 0) exit_check_interval = 1;
+  }
+  std::cout<<"[TESTBENCH]: Checking exit_valid every "<<exit_check_interval<<" cycles"<<std::endl;
+
+  return exit_check_interval;
+}
+
+unsigned int XHEEP_CmdLineOptions::get_threads()
+{
+  std::string arg_threads = this->getCmdOption(this->argc, this->argv, "+threads=");
+  unsigned int threads = 0;
+
+  if(arg_threads.empty()){
+    std::cout<<"[TESTBENCH]: No number of threads specified, using the model default"<<std::endl;
+  } else {
+    threads = stoul(arg_threads);
+    std::cout<<"[TESTBENCH]: Simulating with "<<threads<<" threads"<<std::endl;
+  }
+
+  return threads;
+}
+
+std::string XHEEP_CmdLineOptions::get_save_checkpoint(uint64_t& save_cycle)
+{
+  std::string checkpoint     = this->getCmdOption(this->argc, this->argv, "+save_checkpoint=");
+  std::string arg_save_cycle = this->getCmdOption(this->argc, this->argv, "+save_checkpoint_cycle=");
+
+  save_cycle = arg_save_cycle.empty() ? 0 : stoull(arg_save_cycle);
+
+  if(!checkpoint.empty()) {
+    if(save_cycle == 0)
+      std::cout<<"[TESTBENCH]: Saving checkpoint "<<checkpoint<<" after reset"<<std::endl;
+    else
+      std::cout<<"[TESTBENCH]: Saving checkpoint "<<checkpoint<<" at cycle "<<save_cycle<<std::endl;
+  }
+
+  return checkpoint;
+}
+
+std::string XHEEP_CmdLineOptions::get_restore_checkpoint()
+{
+  std::string checkpoint = this->getCmdOption(this->argc, this->argv, "+restore_checkpoint=");
+
+  if(!checkpoint.empty()) {
+    std::cout<<"[TESTBENCH]: Restoring checkpoint "<<checkpoint<<std::endl;
+  }
+
+  return checkpoint;
+}
+
+trace_mode_t XHEEP_CmdLineOptions::get_trace_mode()
+{
+  std::string arg_trace = this->getCmdOption(this->argc, this->argv, "+trace=");
+  trace_mode_t trace_mode = TRACE_OFF;
+
+  if(arg_trace.empty() || arg_trace.compare("off") == 0){
+    std::cout<<"[TESTBENCH]: Waveform dumping disabled"<<std::endl;
+    trace_mode = TRACE_OFF;
+  } else if(arg_trace.compare("fst") == 0) {
+    std::cout<<"[TESTBENCH]: Waveform dumping enabled for the whole simulation"<<std::endl;
+    trace_mode = TRACE_FST;
+  } else if(arg_trace.compare("window") == 0) {
+    std::cout<<"[TESTBENCH]: Waveform dumping enabled in a cycle window"<<std::endl;
+    trace_mode = TRACE_WINDOW;
+  } else if(arg_trace.compare("trigger") == 0) {
+    std::cout<<"[TESTBENCH]: Waveform dumping enabled from a trigger condition"<<std::endl;
+    trace_mode = TRACE_TRIGGER;
+  } else {
+    std::cout<<"[TESTBENCH]: Wrong Trace Option specified (off, fst, window, trigger) - using off"<<std::endl;
+    trace_mode = TRACE_OFF;
+  }
+
+  return trace_mode;
+}
+
+void XHEEP_CmdLineOptions::get_trace_window(uint64_t& start_cycle, uint64_t& stop_cycle)
+{
+  std::string arg_trace_start = this->getCmdOption(this->argc, this->argv, "+trace_start=");
+  std::string arg_trace_stop  = this->getCmdOption(this->argc, this->argv, "+trace_stop=");
+
+  start_cycle = 0;
+  stop_cycle  = UINT64_MAX;
+
+  if(!arg_trace_start.empty()) start_cycle = stoull(arg_trace_start);
+  if(!arg_trace_stop.empty())  stop_cycle  = stoull(arg_trace_stop);
+
+  if(stop_cycle < start_cycle) {
+    std::cout<<"[TESTBENCH]: Trace stop cycle is before the start cycle - nothing will be dumped"<<std::endl;
+  }
+
+  std::cout<<"[TESTBENCH]: Dumping waveforms from cycle "<<start_cycle;
+  if(stop_cycle == UINT64_MAX) std::cout<<" until the end"<<std::endl;
+  else std::cout<<" to cycle "<<stop_cycle<<std::endl;
+}
+
+void XHEEP_CmdLineOptions::get_trace_trigger(trace_trigger_t& trigger)
+{
+  std::string arg_trigger_pc      = this->getCmdOption(this->argc, this->argv, "+trace_trigger_pc=");
+  std::string arg_trigger_addr    = this->getCmdOption(this->argc, this->argv, "+trace_trigger_addr=");
+  std::string arg_trigger_length  = this->getCmdOption(this->argc, this->argv, "+trace_trigger_length=");
+  std::string arg_trace_history   = this->getCmdOption(this->argc, this->argv, "+trace_history=");
+
+  trigger.on_pc   = !arg_trigger_pc.empty();
+  trigger.pc      = trigger.on_pc ? stoul(arg_trigger_pc, nullptr, 0) : 0;
+  trigger.on_addr = !arg_trigger_addr.empty();
+  trigger.addr    = trigger.on_addr ? stoul(arg_trigger_addr, nullptr, 0) : 0;
+  trigger.on_exit = this->hasCmdFlag(this->argc, this->argv, "+trace_trigger_exit");
+  trigger.length  = arg_trigger_length.empty() ? 0 : stoull(arg_trigger_length);
+  trigger.history = arg_trace_history.empty() ? 0 : stoul(arg_trace_history);
+
+  if(trigger.on_pc)
+    std::cout<<"[TESTBENCH]: Trace trigger on instruction fetch at 0x"<<std::hex<<trigger.pc<<std::dec<<std::endl;
+  if(trigger.on_addr)
+    std::cout<<"[TESTBENCH]: Trace trigger on data access at 0x"<<std::hex<<trigger.addr<<std::dec<<std::endl;
+  if(trigger.on_exit)
+    std::cout<<"[TESTBENCH]: Trace trigger on exit_valid"<<std::endl;
+  if(!trigger.on_pc && !trigger.on_addr && !trigger.on_exit)
+    std::cout<<"[TESTBENCH]: No trace trigger specified - nothing will be dumped"<<std::endl;
+  if(trigger.length != 0)
+    std::cout<<"[TESTBENCH]: Dumping "<<trigger.length<<" cycles after the trigger"<<std::endl;
+  if(trigger.history != 0)
+    std::cout<<"[TESTBENCH]: Keeping the last "<<trigger.history<<" cycles of bus state in trace_history.log"<<std::endl;
+}
+
+unsigned int XHEEP_CmdLineOptions::get_profile_period(bool& stacks)
+{
+  std::string arg_profile = this->getCmdOption(this->argc, this->argv, "+profile=");
+  unsigned int period = arg_profile.empty() ? 0 : stoul(arg_profile);
+
+  stacks = period != 0 && this->hasCmdFlag(this->argc, this->argv, "+profile_stacks");
+
+  if(period != 0) {
+    std::cout<<"[TESTBENCH]: Sampling the PC every "<<period<<" cycles";
+    if(stacks) std::cout<<" and tracking the call stack";
+    std::cout<<std::endl;
+  }
+
+  return period;
+}
+
+void XHEEP_CmdLineOptions::get_cache_config(cache_config_t& config)
+{
+  std::string arg_sets        = this->getCmdOption(this->argc, this->argv, "+cache_sets=");
+  std::string arg_ways        = this->getCmdOption(this->argc, this->argv, "+cache_ways=");
+  std::string arg_line_size   = this->getCmdOption(this->argc, this->argv, "+cache_line_size=");
+  std::string arg_replacement = this->getCmdOption(this->argc, this->argv, "+cache_replacement=");
+  std::string arg_region      = this->getCmdOption(this->argc, this->argv, "+cache_stats_region=");
+  std::string arg_hit         = this->getCmdOption(this->argc, this->argv, "+cache_hit_latency=");
+  std::string arg_miss        = this->getCmdOption(this->argc, this->argv, "+cache_miss_latency=");
+  std::string arg_outstanding = this->getCmdOption(this->argc, this->argv, "+obi_outstanding=");
+
+  // defaults to the original 4KB direct-mapped cache with 16-byte lines
+  config.sets        = arg_sets.empty() ? 256 : stoul(arg_sets);
+  config.ways        = arg_ways.empty() ? 1 : stoul(arg_ways);
+  config.line_size   = arg_line_size.empty() ? 16 : stoul(arg_line_size);
+  config.replacement = arg_replacement.empty() ? "lru" : arg_replacement;
+  config.dmi         = this->hasCmdFlag(this->argc, this->argv, "+dmi");
+  config.stats_region = arg_region.empty() ? 4096 : stoul(arg_region, NULL, 0);
+  config.hit_latency  = arg_hit.empty() ? 20 : stoul(arg_hit);
+  config.miss_latency = arg_miss.empty() ? 100 : stoul(arg_miss);
+  config.outstanding  = arg_outstanding.empty() ? 4 : stoul(arg_outstanding);
+}
+
+void XHEEP_CmdLineOptions::get_ext_mem_config(ext_mem_config_t& config)
+{
+  std::string arg_size = this->getCmdOption(this->argc, this->argv, "+ext_mem_size=");
+
+  // decimal or 0x-prefixed hexadecimal, defaults to the original 32KB
+  config.size  = arg_size.empty() ? 32*1024 : stoull(arg_size, NULL, 0);
+  config.file  = this->getCmdOption(this->argc, this->argv, "+ext_mem_file=");
+  config.image = this->getCmdOption(this->argc, this->argv, "+ext_mem_image=");
+  config.dump  = this->getCmdOption(this->argc, this->argv, "+ext_mem_dump=");
+}
+
+unsigned int XHEEP_CmdLineOptions::get_systemc_log_level()
+{
+  std::string arg_level = this->getCmdOption(this->argc, this->argv, "+systemc_log_level=");
+
+  // defaults to the OBI requests and the cache events, without the cache status
+  return arg_level.empty() ? 2 : stoul(arg_level);
+}
@@ -2,18 +2,73 @@
 #define XHEEP_TB_UTIL_H
 
 #include <iostream>
+#include <stdint.h>
+#include <string>
 
-class XHEEP_CmdLineOptions // declare Calculator class
+// waveform dumping modes selected with +trace=
+enum trace_mode_t {
+  TRACE_OFF    = 0,
+  TRACE_FST    = 1,
+  TRACE_WINDOW = 2,
+  TRACE_TRIGGER = 3
+};
+
+// conditions that start the waveform dump in TRACE_TRIGGER mode
+typedef struct trace_trigger {
+  bool         on_pc;    // instruction fetch address matches pc
+  uint32_t     pc;
+  bool         on_addr;  // data access address matches addr
+  uint32_t     addr;
+  bool         on_exit;  // exit_valid_o is asserted
+  uint64_t     length;   // cycles dumped after the trigger, 0 dumps until the end
+  unsigned int history;  // cycles of bus state kept in a ring buffer before the trigger
+} trace_trigger_t;
+
+// geometry of the cache in front of the SystemC external memory, selected with +cache_*
+typedef struct cache_config {
+  unsigned int sets;
+  unsigned int ways;
+  unsigned int line_size;    // bytes
+  std::string  replacement;  // lru, plru or random
+  bool         dmi;          // direct memory interface to the main memory
+  unsigned int stats_region; // bytes of the address regions of the statistics heatmap
+  unsigned int hit_latency;  // ns
+  unsigned int miss_latency; // ns, on top of the main memory transactions
+  unsigned int outstanding;  // OBI requests waiting for their response
+} cache_config_t;
+
+// SystemC external main memory, selected with +ext_mem_*
+typedef struct ext_mem_config {
+  uint64_t     size;   // bytes
+  std::string  file;   // backing file the memory is mapped on, empty for a memory on the heap
+  std::string  image;  // initial content, raw binary or .hex/.elf
+  std::string  dump;   // raw binary written at the end of the simulation
+} ext_mem_config_t;
+
+// plusargs (+option=value and +flag) of the Verilator and SystemC testbenches
+class XHEEP_CmdLineOptions
 {
 
   public: // public members
     XHEEP_CmdLineOptions(int argc, char* argv[]); // default constructor
 
     std::string getCmdOption(int argc, char* argv[], const std::string& option); // get options from cmd lines
+    bool hasCmdFlag(int argc, char* argv[], const std::string& flag); // options without a value
     bool get_use_openocd();
     std::string get_firmware();
     unsigned int get_max_sim_time(bool& run_all);
     unsigned int get_boot_sel();
+    trace_mode_t get_trace_mode();
+    void get_trace_window(uint64_t& start_cycle, uint64_t& stop_cycle);
+    void get_trace_trigger(trace_trigger_t& trigger);
+    unsigned int get_exit_check_interval();
+    unsigned int get_threads();
+    std::string get_save_checkpoint(uint64_t& save_cycle);
+    std::string get_restore_checkpoint();
+    unsigned int get_profile_period(bool& stacks);
+    void get_cache_config(cache_config_t& config);
+    void get_ext_mem_config(ext_mem_config_t& config);
+    unsigned int get_systemc_log_level();
     int argc;
     char** argv;
 
@@ -0,0 +1,175 @@
+#include "XHEEP_FirmwareLoader.hh"
+#include <elf.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+bool XHEEP_FirmwareLoader::load(const std::string& file)
+{
+  std::ifstream firmware_file(file, std::ios::binary);
+
+  if(!firmware_file.is_open()) {
+    std::cout<<"[TESTBENCH]: ERROR: cannot open firmware "<<file<<std::endl;
+    return false;
+  }
+
+  std::vector<uint8_t> image((std::istreambuf_iterator<char>(firmware_file)), std::istreambuf_iterator<char>());
+  segments.clear();
+  symbols.clear();
+
+  if(image.size() >= SELFMAG && memcmp(image.data(), ELFMAG, SELFMAG) == 0)
+    return load_elf(image);
+  else
+    return load_hex(image);
+}
+
+// objcopy -O verilog format: "@<hex address>" lines followed by lines of hex bytes
+bool XHEEP_FirmwareLoader::load_hex(const std::vector<uint8_t>& image)
+{
+  uint32_t addr = 0;
+  size_t   i    = 0;
+
+  while(i < image.size()) {
+    char c = image[i];
+    if(c == '@') {
+      size_t end = i + 1;
+      while(end < image.size() && isxdigit(image[end])) end++;
+      addr = strtoul(std::string(image.begin() + i + 1, image.begin() + end).c_str(), NULL, 16);
+      i = end;
+    } else if(isxdigit(c)) {
+      if(i + 1 >= image.size() || !isxdigit(image[i+1])) {
+        std::cout<<"[TESTBENCH]: ERROR: malformed hex firmware"<<std::endl;
+        return false;
+      }
+      char byte_str[3] = { (char)image[i], (char)image[i+1], 0 };
+      // start a new segment when the address is not contiguous to the last one
+      if(segments.empty() || segments.back().addr + segments.back().data.size() != addr) {
+        segments.push_back(segment_t());
+        segments.back().addr = addr;
+      }
+      segments.back().data.push_back((uint8_t)strtoul(byte_str, NULL, 16));
+      addr++;
+      i += 2;
+    } else {
+      i++;
+    }
+  }
+
+  return true;
+}
+
+// Loads the PT_LOAD segments at their physical (load) address, as objcopy does
+bool XHEEP_FirmwareLoader::load_elf(const std::vector<uint8_t>& image)
+{
+  const Elf32_Ehdr* ehdr = (const Elf32_Ehdr*)image.data();
+
+  if(image.size() < sizeof(Elf32_Ehdr) || ehdr->e_ident[EI_CLASS] != ELFCLASS32 || ehdr->e_ident[EI_DATA] != ELFDATA2LSB) {
+    std::cout<<"[TESTBENCH]: ERROR: only 32-bit little-endian ELF files are supported"<<std::endl;
+    return false;
+  }
+
+  for(int i = 0; i < ehdr->e_phnum; i++) {
+    size_t phdr_offset = ehdr->e_phoff + i * ehdr->e_phentsize;
+    if(phdr_offset + sizeof(Elf32_Phdr) > image.size()) {
+      std::cout<<"[TESTBENCH]: ERROR: truncated ELF program headers"<<std::endl;
+      return false;
+    }
+    const Elf32_Phdr* phdr = (const Elf32_Phdr*)(image.data() + phdr_offset);
+
+    if(phdr->p_type != PT_LOAD || phdr->p_filesz == 0) continue;
+    if(phdr->p_offset + phdr->p_filesz > image.size()) {
+      std::cout<<"[TESTBENCH]: ERROR: truncated ELF segment"<<std::endl;
+      return false;
+    }
+
+    segments.push_back(segment_t());
+    segments.back().addr = phdr->p_paddr;
+    segments.back().data.assign(image.begin() + phdr->p_offset, image.begin() + phdr->p_offset + phdr->p_filesz);
+  }
+
+  load_elf_symbols(image);
+
+  return true;
+}
+
+// Reads the symbol table, if the ELF was not stripped
+void XHEEP_FirmwareLoader::load_elf_symbols(const std::vector<uint8_t>& image)
+{
+  const Elf32_Ehdr* ehdr = (const Elf32_Ehdr*)image.data();
+
+  if(ehdr->e_shoff == 0 || ehdr->e_shoff + ehdr->e_shnum * sizeof(Elf32_Shdr) > image.size()) return;
+  const Elf32_Shdr* shdrs = (const Elf32_Shdr*)(image.data() + ehdr->e_shoff);
+
+  for(int i = 0; i < ehdr->e_shnum; i++) {
+    if(shdrs[i].sh_type != SHT_SYMTAB || shdrs[i].sh_link >= ehdr->e_shnum) continue;
+
+    const Elf32_Shdr& strtab = shdrs[shdrs[i].sh_link];
+    if(shdrs[i].sh_offset + shdrs[i].sh_size > image.size() || strtab.sh_offset + strtab.sh_size > image.size()) return;
+
+    const Elf32_Sym* syms = (const Elf32_Sym*)(image.data() + shdrs[i].sh_offset);
+    const char* names = (const char*)(image.data() + strtab.sh_offset);
+
+    for(size_t j = 0; j < shdrs[i].sh_size / sizeof(Elf32_Sym); j++) {
+      int type = ELF32_ST_TYPE(syms[j].st_info);
+      if((type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE) || syms[j].st_name >= strtab.sh_size)
+        continue;
+      if(syms[j].st_shndx == SHN_UNDEF || names[syms[j].st_name] == 0) continue;
+
+      symbol_t symbol;
+      symbol.name        = names + syms[j].st_name;
+      symbol.addr        = syms[j].st_value;
+      symbol.size        = syms[j].st_size;
+      symbol.is_function = type == STT_FUNC;
+      symbols.push_back(symbol);
+    }
+  }
+}
+
+bool XHEEP_FirmwareLoader::get_symbol_address(const std::string& name, uint32_t& addr)
+{
+  for(const symbol_t& symbol : symbols) {
+    if(symbol.name == name) {
+      addr = symbol.addr;
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned int XHEEP_FirmwareLoader::write(std::function<bool(uint32_t addr, uint32_t word)> write_word)
+{
+  // merge the segments byte by byte first: a word shared by two segments (e.g. .text ending
+  // and .rodata starting in the middle of it) is written once with the bytes of both
+  std::map<uint32_t, uint32_t> words;
+
+  for(const segment_t& segment : segments) {
+    for(uint32_t i = 0; i < segment.data.size(); i++) {
+      uint32_t addr  = segment.addr + i;
+      uint32_t shift = 8*(addr & 3u);
+      uint32_t& word = words[addr & ~3u];
+      word = (word & ~(0xFFu << shift)) | ((uint32_t)segment.data[i] << shift);
+    }
+  }
+
+  // bytes of a word not covered by any segment are zero
+  unsigned int nwords = 0, ndropped = 0;
+  uint32_t first_dropped = 0;
+  for(const auto& word : words) {
+    if(write_word(word.first, word.second)) {
+      nwords++;
+    } else {
+      if(ndropped == 0) first_dropped = word.first;
+      ndropped++;
+    }
+  }
+
+  if(ndropped != 0)
+    std::cout<<"[TESTBENCH]: WARNING: "<<ndropped<<" firmware words are outside the memories and were not loaded, the first at 0x"
+             <<std::hex<<first_dropped<<std::dec<<std::endl;
+
+  return nwords;
+}
@@ -0,0 +1,46 @@
+#ifndef XHEEP_FIRMWARE_LOADER_H
+#define XHEEP_FIRMWARE_LOADER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+// Loads a firmware (Verilog hex from objcopy or ELF) in the testbench memories
+// without going through the SystemVerilog $readmemh and per-bank loops:
+// only the populated parts of the image are written.
+class XHEEP_FirmwareLoader
+{
+
+  public:
+    // contiguous part of the firmware image
+    typedef struct segment {
+      uint32_t             addr;
+      std::vector<uint8_t> data;
+    } segment_t;
+
+    // ELF symbol, only available when the firmware is an ELF file
+    typedef struct symbol {
+      std::string name;
+      uint32_t    addr;
+      uint32_t    size;
+      bool        is_function;
+    } symbol_t;
+
+    std::vector<segment_t> segments;
+    std::vector<symbol_t>  symbols;
+
+    bool load(const std::string& file);  // parse the file, false on error
+    bool get_symbol_address(const std::string& name, uint32_t& addr);
+    // call write_word for every 32-bit word covered by the segments, write_word returns false when
+    // the word is outside the memories; returns the number of words written and warns about the others
+    unsigned int write(std::function<bool(uint32_t addr, uint32_t word)> write_word);
+
+  private:
+    bool load_hex(const std::vector<uint8_t>& image);
+    bool load_elf(const std::vector<uint8_t>& image);
+    void load_elf_symbols(const std::vector<uint8_t>& image);
+
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "XHEEP_Profiler.hh"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+XHEEP_Profiler::XHEEP_Profiler(unsigned int period, bool stacks)
+{
+  this->period    = period == 0 ? 1 : period;
+  this->stacks    = stacks;
+  countdown       = this->period;
+  nsamples        = 0;
+  last_function   = UNKNOWN_FUNCTION;
+}
+
+void XHEEP_Profiler::set_symbols(const std::vector<XHEEP_FirmwareLoader::symbol_t>& symbols)
+{
+  functions.clear();
+  for(const XHEEP_FirmwareLoader::symbol_t& symbol : symbols) {
+    if(!symbol.is_function) continue;
+    function_t f;
+    f.name  = symbol.name;
+    f.start = symbol.addr;
+    f.end   = symbol.addr + symbol.size;
+    functions.push_back(f);
+  }
+
+  std::sort(functions.begin(), functions.end(),
+            [](const function_t& a, const function_t& b) { return a.start < b.start; });
+  // aliases at the same address are dropped, functions without size (assembly) extend to the next one
+  functions.erase(std::unique(functions.begin(), functions.end(),
+                              [](const function_t& a, const function_t& b) { return a.start == b.start; }),
+                  functions.end());
+  for(size_t i = 0; i < functions.size(); i++) {
+    if(functions[i].end == functions[i].start)
+      functions[i].end = i + 1 < functions.size() ? functions[i+1].start : functions[i].start + 4;
+  }
+
+  if(functions.empty())
+    std::cout<<"[TESTBENCH]: No function symbols in the firmware, the profile will only have addresses"<<std::endl;
+}
+
+int XHEEP_Profiler::find_function(uint32_t pc)
+{
+  auto it = std::upper_bound(functions.begin(), functions.end(), pc,
+                             [](uint32_t pc, const function_t& f) { return pc < f.start; });
+  if(it == functions.begin()) return UNKNOWN_FUNCTION;
+  --it;
+  return pc < it->end ? (int)(it - functions.begin()) : UNKNOWN_FUNCTION;
+}
+
+std::string XHEEP_Profiler::function_name(int idx)
+{
+  return idx == UNKNOWN_FUNCTION ? "[unknown]" : functions[idx].name;
+}
+
+// Heuristic shadow stack: entering a function at its first instruction is a call,
+// landing in the middle of a function already in the stack is a return to it
+void XHEEP_Profiler::track_stack(uint32_t pc)
+{
+  if(last_function != UNKNOWN_FUNCTION && pc > functions[last_function].start && pc < functions[last_function].end)
+    return;
+
+  int f = find_function(pc);
+  last_function = f;
+  if(f == UNKNOWN_FUNCTION) return;
+
+  if(pc == functions[f].start) {
+    if(call_stack.size() < MAX_STACK_DEPTH) call_stack.push_back(f);
+    return;
+  }
+
+  for(size_t i = call_stack.size(); i > 0; i--) {
+    if(call_stack[i-1] == f) {
+      call_stack.resize(i);
+      return;
+    }
+  }
+  // neither a call nor a return (e.g. a tail call or a trap): replace the innermost function
+  if(call_stack.empty()) call_stack.push_back(f);
+  else call_stack.back() = f;
+}
+
+std::string XHEEP_Profiler::stack_key()
+{
+  std::string key;
+  for(int f : call_stack) {
+    if(!key.empty()) key += ";";
+    key += function_name(f);
+  }
+  return key;
+}
+
+void XHEEP_Profiler::sample(uint32_t pc)
+{
+  int f = find_function(pc);
+  std::string key = stacks ? stack_key() : "";
+
+  // the sampled instruction may not be retired yet, so its function can be missing from the stack
+  if(key.empty() || call_stack.back() != f) {
+    if(!key.empty()) key += ";";
+    key += function_name(f);
+  }
+
+  pc_samples[pc]++;
+  stack_samples[key]++;
+  nsamples++;
+}
+
+void XHEEP_Profiler::write_profile(const std::string& file)
+{
+  std::ofstream profile_file(file);
+  std::unordered_map<int, uint64_t> function_samples;
+  std::vector<std::pair<uint32_t, uint64_t>> hot_pcs(pc_samples.begin(), pc_samples.end());
+  auto by_samples = [](const std::pair<int, uint64_t>& a, const std::pair<int, uint64_t>& b) { return a.second > b.second; };
+
+  for(const auto& s : pc_samples) function_samples[find_function(s.first)] += s.second;
+  std::vector<std::pair<int, uint64_t>> flat(function_samples.begin(), function_samples.end());
+  std::sort(flat.begin(), flat.end(), by_samples);
+  std::sort(hot_pcs.begin(), hot_pcs.end(),
+            [](const std::pair<uint32_t, uint64_t>& a, const std::pair<uint32_t, uint64_t>& b) { return a.second > b.second; });
+
+  profile_file<<"# "<<nsamples<<" samples, one every "<<period<<" cycles"<<std::endl;
+  profile_file<<std::setw(10)<<"SAMPLES"<<std::setw(9)<<"%"<<"  FUNCTION"<<std::endl;
+  for(const auto& f : flat) {
+    profile_file<<std::setw(10)<<f.second<<std::setw(9)<<std::fixed<<std::setprecision(2)<<100.0*f.second/nsamples
+                <<"  "<<function_name(f.first)<<"\n";
+  }
+
+  profile_file<<std::endl<<"# hottest PCs"<<std::endl;
+  profile_file<<std::setw(10)<<"SAMPLES"<<std::setw(9)<<"%"<<"  PC          LOCATION"<<std::endl;
+  for(size_t i = 0; i < hot_pcs.size() && i < 20; i++) {
+    int f = find_function(hot_pcs[i].first);
+    profile_file<<std::setw(10)<<hot_pcs[i].second<<std::setw(9)<<100.0*hot_pcs[i].second/nsamples
+                <<"  0x"<<std::hex<<std::setw(8)<<std::setfill('0')<<hot_pcs[i].first<<std::setfill(' ')<<"  "
+                <<function_name(f);
+    if(f != UNKNOWN_FUNCTION) profile_file<<"+0x"<<hot_pcs[i].first - functions[f].start;
+    profile_file<<std::dec<<"\n";
+  }
+
+  std::cout<<"[TESTBENCH]: Wrote the profile of "<<nsamples<<" samples in "<<file<<std::endl;
+}
+
+void XHEEP_Profiler::write_folded(const std::string& file)
+{
+  std::ofstream folded_file(file);
+
+  for(const auto& s : stack_samples) folded_file<<s.first<<" "<<s.second<<"\n";
+
+  std::cout<<"[TESTBENCH]: Wrote the folded stacks in "<<file<<std::endl;
+}
@@ -0,0 +1,66 @@
+#ifndef XHEEP_PROFILER_H
+#define XHEEP_PROFILER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "XHEEP_FirmwareLoader.hh"
+
+// Statistical profiler of the firmware: the PC of the instruction in the
+// retire stage of the core is sampled every period cycles and mapped on the
+// ELF function symbols. Optionally, a shadow call stack is rebuilt from the
+// retired PCs (every cycle) to produce folded stacks for flamegraphs.
+class XHEEP_Profiler
+{
+
+  public:
+    XHEEP_Profiler(unsigned int period, bool stacks);
+
+    void set_symbols(const std::vector<XHEEP_FirmwareLoader::symbol_t>& symbols);
+    // called once per clock cycle with the PC in the retire stage and whether it retires
+    void cycle(bool retired, uint32_t pc)
+    {
+      if(stacks && retired) track_stack(pc);
+      if(--countdown == 0) {
+        countdown = period;
+        sample(pc);
+      }
+    }
+    // flat profile per function and hottest PCs
+    void write_profile(const std::string& file);
+    // one line per stack, "outer;inner samples", as expected by flamegraph.pl
+    void write_folded(const std::string& file);
+
+    bool stacks;
+
+  private:
+    typedef struct function {
+      std::string name;
+      uint32_t    start;
+      uint32_t    end;
+    } function_t;
+
+    static const unsigned int MAX_STACK_DEPTH = 256;
+    static const int UNKNOWN_FUNCTION = -1;
+
+    void sample(uint32_t pc);
+    void track_stack(uint32_t pc);
+    int find_function(uint32_t pc);
+    std::string function_name(int idx);
+    std::string stack_key();
+
+    unsigned int period;
+    unsigned int countdown;
+    uint64_t nsamples;
+
+    std::vector<function_t> functions;  // sorted by start address
+    std::unordered_map<uint32_t, uint64_t> pc_samples;
+    std::unordered_map<std::string, uint64_t> stack_samples;
+    std::vector<int> call_stack;        // indexes in functions
+    int last_function;                  // function of the last tracked PC
+
+};
+
+#endif
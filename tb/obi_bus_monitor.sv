@@ -0,0 +1,205 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+// Performance counters of the system bus, enabled with the +bus_stats plusarg.
+// For every master and slave port of the system crossbar it counts the OBI
+// transactions, the cycles a request waits for the grant and the cycles from
+// the grant to rvalid, with histograms of both. The counters are written in
+// bus_stats.csv and bus_stats.json at the end of the simulation. Grants beyond
+// MAX_OUTSTANDING pending transactions on a port are not timed; they are counted
+// as overflows and reported, and MAX_OUTSTANDING must then be raised.
+
+module obi_bus_monitor
+  import obi_pkg::*;
+#(
+    parameter int unsigned NMASTER = 1,
+    parameter int unsigned NSLAVE = 1,
+    // outstanding transactions tracked per port
+    parameter int unsigned MAX_OUTSTANDING = 8
+) (
+    input logic clk_i,
+    input logic rst_ni,
+
+    input obi_req_t  [NMASTER-1:0] master_req_i,
+    input obi_resp_t [NMASTER-1:0] master_resp_i,
+
+    input obi_req_t  [ NSLAVE-1:0] slave_req_i,
+    input obi_resp_t [ NSLAVE-1:0] slave_resp_i
+);
+
+  import core_v_mini_mcu_pkg::*;
+
+  // histogram bins: 0, 1, 2, 3, 4-7, 8-15, 16-31, 32+ cycles
+  localparam int unsigned NBINS = 8;
+  localparam int unsigned NPORTS = NMASTER + NSLAVE;
+
+  obi_req_t  [NPORTS-1:0] req;
+  obi_resp_t [NPORTS-1:0] resp;
+
+  // masters first, then slaves
+  assign req  = {slave_req_i, master_req_i};
+  assign resp = {slave_resp_i, master_resp_i};
+
+  bit enabled;
+  longint unsigned cycles;
+  longint unsigned transactions[NPORTS];
+  longint unsigned stall_cycles[NPORTS];
+  longint unsigned latency_cycles[NPORTS];
+  longint unsigned max_latency[NPORTS];
+  longint unsigned stall_hist[NPORTS][NBINS];
+  longint unsigned latency_hist[NPORTS][NBINS];
+  longint unsigned overflows[NPORTS];
+
+  // per port state of the transaction being granted and of the outstanding ones
+  int unsigned stall_count[NPORTS];
+  longint unsigned gnt_cycle[NPORTS][MAX_OUTSTANDING];
+  int unsigned gnt_wptr[NPORTS];
+  int unsigned gnt_rptr[NPORTS];
+  int unsigned gnt_count[NPORTS];
+
+  function automatic int unsigned hist_bin(longint unsigned value);
+    if (value < 4) return int'(value);
+    else if (value < 8) return 4;
+    else if (value < 16) return 5;
+    else if (value < 32) return 6;
+    else return 7;
+  endfunction
+
+  function automatic string port_name(int unsigned port);
+    int unsigned idx;
+    if (port < SYSTEM_XBAR_NMASTER) begin
+      if (port == CORE_INSTR_IDX) return "core_instr";
+      if (port == CORE_DATA_IDX) return "core_data";
+      if (port == DEBUG_MASTER_IDX) return "debug_master";
+      if (port == SPI_SLAVE_IDX) return "spi_slave";
+      idx = port - DMA_READ_P0_IDX;
+      case (idx % 3)
+        0: return $sformatf("dma_read_p%0d", idx / 3);
+        1: return $sformatf("dma_write_p%0d", idx / 3);
+        default: return $sformatf("dma_addr_p%0d", idx / 3);
+      endcase
+    end else if (port < NMASTER) begin
+      return $sformatf("ext_master%0d", port - SYSTEM_XBAR_NMASTER);
+    end else begin
+      idx = port - NMASTER;
+      if (idx == ERROR_IDX) return "error";
+      if (idx == DEBUG_IDX) return "debug";
+      if (idx == AO_PERIPHERAL_IDX) return "ao_peripheral";
+      if (idx == PERIPHERAL_IDX) return "peripheral";
+      if (idx == FLASH_MEM_IDX) return "flash_mem";
+      return $sformatf("ram%0d", idx - RAM0_IDX);
+    end
+  endfunction
+
+  initial begin
+    enabled = $test$plusargs("bus_stats");
+    cycles  = 0;
+    for (int p = 0; p < NPORTS; p++) begin
+      transactions[p]   = 0;
+      stall_cycles[p]   = 0;
+      latency_cycles[p] = 0;
+      max_latency[p]    = 0;
+      overflows[p]      = 0;
+      stall_count[p]    = 0;
+      gnt_wptr[p]       = 0;
+      gnt_rptr[p]       = 0;
+      gnt_count[p]      = 0;
+      for (int b = 0; b < NBINS; b++) begin
+        stall_hist[p][b]   = 0;
+        latency_hist[p][b] = 0;
+      end
+    end
+  end
+
+  always @(posedge clk_i) begin
+    longint unsigned latency;
+    if (enabled && rst_ni) begin
+      cycles++;
+      for (int p = 0; p < NPORTS; p++) begin
+        // rvalid comes at least one cycle after the grant of the same transaction
+        if (resp[p].rvalid && gnt_count[p] != 0) begin
+          latency = cycles - gnt_cycle[p][gnt_rptr[p]];
+          latency_cycles[p] += latency;
+          if (latency > max_latency[p]) max_latency[p] = latency;
+          latency_hist[p][hist_bin(latency)]++;
+          gnt_rptr[p] = (gnt_rptr[p] + 1) % MAX_OUTSTANDING;
+          gnt_count[p]--;
+        end
+        if (req[p].req) begin
+          if (resp[p].gnt) begin
+            transactions[p]++;
+            stall_hist[p][hist_bin(stall_count[p])]++;
+            stall_count[p] = 0;
+            if (gnt_count[p] == MAX_OUTSTANDING) begin
+              // overwriting the oldest grant would shift the latency of all the pending ones
+              if (overflows[p] == 0)
+                $warning("[BUS_STATS]: more than %0d outstanding transactions on %s, raise MAX_OUTSTANDING",
+                         MAX_OUTSTANDING, port_name(p));
+              overflows[p]++;
+            end else begin
+              gnt_cycle[p][gnt_wptr[p]] = cycles;
+              gnt_wptr[p] = (gnt_wptr[p] + 1) % MAX_OUTSTANDING;
+              gnt_count[p]++;
+            end
+          end else begin
+            stall_cycles[p]++;
+            stall_count[p]++;
+          end
+        end
+      end
+    end
+  end
+
+  final begin
+    int csv, json;
+    longint unsigned total_overflows;
+    if (enabled) begin
+      csv = $fopen("bus_stats.csv", "w");
+      $fwrite(csv, "port,type,transactions,stall_cycles,avg_stall,latency_cycles,avg_latency,max_latency,overflows");
+      for (int b = 0; b < NBINS; b++) $fwrite(csv, ",stall_bin%0d", b);
+      for (int b = 0; b < NBINS; b++) $fwrite(csv, ",latency_bin%0d", b);
+      $fwrite(csv, "\n");
+      for (int p = 0; p < NPORTS; p++) begin
+        $fwrite(csv, "%s,%s,%0d,%0d,%.3f,%0d,%.3f,%0d,%0d", port_name(p), p < NMASTER ? "master" : "slave",
+                transactions[p], stall_cycles[p],
+                transactions[p] == 0 ? 0.0 : real'(stall_cycles[p]) / real'(transactions[p]),
+                latency_cycles[p],
+                transactions[p] == 0 ? 0.0 : real'(latency_cycles[p]) / real'(transactions[p]),
+                max_latency[p], overflows[p]);
+        for (int b = 0; b < NBINS; b++) $fwrite(csv, ",%0d", stall_hist[p][b]);
+        for (int b = 0; b < NBINS; b++) $fwrite(csv, ",%0d", latency_hist[p][b]);
+        $fwrite(csv, "\n");
+      end
+      $fclose(csv);
+
+      json = $fopen("bus_stats.json", "w");
+      $fwrite(json, "{\n  \"cycles\": %0d,\n", cycles);
+      $fwrite(json, "  \"bins\": [\"0\", \"1\", \"2\", \"3\", \"4-7\", \"8-15\", \"16-31\", \"32+\"],\n");
+      $fwrite(json, "  \"ports\": [\n");
+      for (int p = 0; p < NPORTS; p++) begin
+        $fwrite(json, "    {\"name\": \"%s\", \"type\": \"%s\", ", port_name(p),
+                p < NMASTER ? "master" : "slave");
+        $fwrite(json, "\"transactions\": %0d, \"stall_cycles\": %0d, \"latency_cycles\": %0d, \"max_latency\": %0d, ",
+                transactions[p], stall_cycles[p], latency_cycles[p], max_latency[p]);
+        $fwrite(json, "\"overflows\": %0d, ", overflows[p]);
+        $fwrite(json, "\"stall_histogram\": [");
+        for (int b = 0; b < NBINS; b++) $fwrite(json, "%0d%s", stall_hist[p][b], b == NBINS - 1 ? "" : ", ");
+        $fwrite(json, "], \"latency_histogram\": [");
+        for (int b = 0; b < NBINS; b++) $fwrite(json, "%0d%s", latency_hist[p][b], b == NBINS - 1 ? "" : ", ");
+        $fwrite(json, "]}%s\n", p == NPORTS - 1 ? "" : ",");
+      end
+      $fwrite(json, "  ]\n}\n");
+      $fclose(json);
+
+      $display("[BUS_STATS]: %0d cycles of bus activity written in bus_stats.csv and bus_stats.json",
+               cycles);
+      total_overflows = 0;
+      for (int p = 0; p < NPORTS; p++) total_overflows += overflows[p];
+      if (total_overflows != 0)
+        $display("[BUS_STATS]: WARNING: %0d grants beyond MAX_OUTSTANDING=%0d were not timed, the latencies are incomplete",
+                 total_overflows, MAX_OUTSTANDING);
+    end
+  end
+
+endmodule
@@ -5,15 +5,21 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <stdio.h>
 
 
-// Target module representing a simple direct mapped cache
+// Set-associative write-back cache, direct mapped with a single way
 class CacheMemory
 {
 
 public:
   uint32_t cache_size_byte    = 4*1024;
   uint32_t number_of_blocks   = 256;
+  uint32_t number_of_sets     = 256;
+  uint32_t number_of_ways     = 1;
 
   uint32_t nbits_blocks       = 0;
   uint32_t nbits_tags         = 0;
@@ -22,59 +28,111 @@ public:
 
   enum { ARCHITECTURE_bits = 32 };
 
+  typedef enum {
+    REPLACEMENT_LRU    = 0,
+    REPLACEMENT_PLRU   = 1,
+    REPLACEMENT_RANDOM = 2
+  } replacement_policy_t;
+
+  replacement_policy_t replacement_policy = REPLACEMENT_LRU;
+
   std::ofstream cacheFile;
 
-  typedef struct cache_line {
-    uint32_t tag;
-    bool    valid;
-    uint8_t* data;
-  } cache_line_t;
+  // Lines are stored as a structure of arrays, number_of_sets x number_of_ways entries
+  // with the ways of a set contiguous: the lookup only scans the packed tags of the set
+  // and all the line data is in a single allocation
+  enum { LINE_VALID = 1, LINE_DIRTY = 2, LINE_TAG_SHIFT = 2 };
 
-  cache_line_t* cache_array;
+  uint32_t* tag_array;      // (tag << LINE_TAG_SHIFT) | LINE_DIRTY | LINE_VALID
+  uint64_t* last_access;    // for LRU
+  uint8_t*  data_slab;      // number_of_blocks * block_size_byte bytes
+  // one tree of number_of_ways-1 bits per set for PLRU, a bit points to the half to replace next
+  uint32_t* plru_tree;
+  uint64_t access_counter = 0;
 
 
   CacheMemory(): cacheFile("cache_status.log")
   {
-    cache_array = NULL;
+    tag_array   = NULL;
+    last_access = NULL;
+    data_slab   = NULL;
+    plru_tree   = NULL;
+  }
+
+  ~CacheMemory()
+  {
+    free_cache();
+  }
+
+  void free_cache() {
+    delete[] tag_array;
+    delete[] last_access;
+    delete[] data_slab;
+    delete[] plru_tree;
+    tag_array   = NULL;
+    last_access = NULL;
+    data_slab   = NULL;
+    plru_tree   = NULL;
   }
 
   void create_cache() {
-      cache_array = new cache_line_t[number_of_blocks];
-      this->block_size_byte = get_block_size();
-      this->nbits_blocks    = log2(block_size_byte);
-      this->nbits_index     = log2(number_of_blocks);
-      this->nbits_tags      = ARCHITECTURE_bits - nbits_index - nbits_blocks;
+      create_cache(256, 1, 16, REPLACEMENT_LRU);
       printf("bits block %d, index %d, tags %d\n",nbits_blocks, nbits_index, nbits_tags );
   }
 
-  void create_cache(uint32_t cache_size_byte, uint32_t number_of_blocks) {
-      this->cache_size_byte = cache_size_byte;
-      this->number_of_blocks = number_of_blocks;
-      cache_array = new cache_line_t[number_of_blocks];
-      this->block_size_byte = get_block_size();
+  bool create_cache(uint32_t number_of_sets, uint32_t number_of_ways, uint32_t block_size_byte, replacement_policy_t replacement_policy) {
+      bool pow2_ways = (number_of_ways & (number_of_ways - 1)) == 0;
+      if (number_of_sets == 0 || (number_of_sets & (number_of_sets - 1)) != 0 ||
+          block_size_byte < 4 || (block_size_byte & (block_size_byte - 1)) != 0 ||
+          number_of_ways == 0 || (replacement_policy == REPLACEMENT_PLRU && (!pow2_ways || number_of_ways > 32))) {
+        std::cout << "Cache geometry not supported: sets and line size must be powers of 2, PLRU needs up to 32 ways (power of 2)" << std::endl;
+        return false;
+      }
+      this->number_of_sets     = number_of_sets;
+      this->number_of_ways     = number_of_ways;
+      this->block_size_byte    = block_size_byte;
+      this->replacement_policy = replacement_policy;
+      this->number_of_blocks   = number_of_sets * number_of_ways;
+      this->cache_size_byte    = number_of_blocks * block_size_byte;
+      // the cache can be created again with another geometry
+      free_cache();
+      tag_array   = new uint32_t[number_of_blocks];
+      last_access = new uint64_t[number_of_blocks];
+      data_slab   = new uint8_t[(size_t)number_of_blocks * block_size_byte];
+      plru_tree   = new uint32_t[number_of_sets];
       this->nbits_blocks    = log2(block_size_byte);
-      this->nbits_index     = log2(number_of_blocks);
+      this->nbits_index     = log2(number_of_sets);
       this->nbits_tags      = ARCHITECTURE_bits - nbits_index - nbits_blocks;
+      return true;
+  }
+
+  static bool get_replacement_policy(const std::string& name, replacement_policy_t& policy) {
+    if (name == "lru")         policy = REPLACEMENT_LRU;
+    else if (name == "plru")   policy = REPLACEMENT_PLRU;
+    else if (name == "random") policy = REPLACEMENT_RANDOM;
+    else return false;
+    return true;
   }
 
   uint32_t initialize_cache() {
-      if(cache_array == NULL) {
+      if(tag_array == NULL) {
         return -1;
       }
       // Initialize memory with random data
-      for (int i = 0; i < number_of_blocks; i++) {
-        cache_array[i].valid = false;
-        cache_array[i].tag   = 0;
-        cache_array[i].data = new uint8_t[block_size_byte];
-        for(int j = 0; j<block_size_byte;j++) {
-          cache_array[i].data[j] = (uint8_t)(i*j);
+      for (uint32_t i = 0; i < number_of_blocks; i++) {
+        tag_array[i]   = 0;
+        last_access[i] = 0;
+        uint8_t* data  = get_line_data(i);
+        for(uint32_t j = 0; j<block_size_byte;j++) {
+          data[j] = (uint8_t)(i*j);
         }
       }
+      for (uint32_t i = 0; i < number_of_sets; i++) plru_tree[i] = 0;
       return 0;
   }
 
   uint32_t get_block_size() {
-    return (uint32_t)(cache_size_byte / number_of_blocks);
+    return block_size_byte;
   }
 
   uint32_t get_index(uint32_t address) {
@@ -95,104 +153,157 @@ public:
     return (uint32_t)(address >> (nbits_index+nbits_blocks));
   }
 
-  uint32_t get_tag_from_index(uint32_t index) {
-    return cache_array[index].tag;
+  uint32_t get_line(uint32_t index, uint32_t way) {
+    return index*number_of_ways + way;
+  }
+
+  uint8_t* get_line_data(uint32_t line) {
+    return &data_slab[(size_t)line * block_size_byte];
   }
 
+  // way holding address, -1 on miss
+  int find_way(uint32_t address) {
+    const uint32_t* set_tags = &tag_array[get_index(address)*number_of_ways];
+    uint32_t key = (get_tag(address) << LINE_TAG_SHIFT) | LINE_VALID;
+    for (uint32_t way = 0; way < number_of_ways; way++) {
+      if ((set_tags[way] & ~(uint32_t)LINE_DIRTY) == key) return way;
+    }
+    return -1;
+  }
 
   bool cache_hit(uint32_t address) {
+    return find_way(address) >= 0;
+  }
+
+  // updates the replacement state after an access to way of set index
+  void touch(uint32_t index, uint32_t way) {
+    last_access[get_line(index, way)] = ++access_counter;
+    if (replacement_policy == REPLACEMENT_PLRU) {
+      uint32_t node = 0;
+      for (uint32_t level = number_of_ways >> 1; level > 0; level >>= 1) {
+        uint32_t right = (way & level) != 0;
+        // point to the other half
+        if (right) plru_tree[index] &= ~(1u << node);
+        else       plru_tree[index] |=  (1u << node);
+        node = 2*node + 1 + right;
+      }
+    }
+  }
+
+  // way to replace for address: an invalid way if any, otherwise the one chosen by the policy
+  uint32_t get_victim_way(uint32_t address) {
     uint32_t index = get_index(address);
-    uint32_t tag   = get_tag(address);
-    return ( cache_array[index].valid && tag == cache_array[index].tag);
+    uint32_t victim = 0;
+
+    for (uint32_t way = 0; way < number_of_ways; way++) {
+      if (!is_entry_valid_at(index, way)) return way;
+    }
 
+    switch (replacement_policy) {
+      case REPLACEMENT_PLRU: {
+        uint32_t node = 0;
+        for (uint32_t level = number_of_ways >> 1; level > 0; level >>= 1) {
+          uint32_t right = (plru_tree[index] >> node) & 1;
+          victim = (victim << 1) | right;
+          node = 2*node + 1 + right;
+        }
+        break;
+      }
+      case REPLACEMENT_RANDOM:
+        victim = rand() % number_of_ways;
+        break;
+      default:
+        for (uint32_t way = 1; way < number_of_ways; way++) {
+          if (last_access[get_line(index, way)] < last_access[get_line(index, victim)]) victim = way;
+        }
+        break;
+    }
+    return victim;
   }
 
-  void add_entry(uint32_t address, uint8_t* new_data) {
+  void add_entry(uint32_t address, uint32_t way, uint8_t* new_data) {
     uint32_t index = get_index(address);
-    uint32_t tag   = get_tag(address);
-    cache_array[index].valid = true;
-    cache_array[index].tag   = tag;
-    memcpy(cache_array[index].data, new_data, block_size_byte);
+    uint32_t line  = get_line(index, way);
+    tag_array[line] = (get_tag(address) << LINE_TAG_SHIFT) | LINE_VALID;
+    memcpy(get_line_data(line), new_data, block_size_byte);
+    touch(index, way);
   }
 
   void get_data(uint32_t address, uint8_t* new_data) {
-    uint32_t index = get_index(address);
-    memcpy(new_data, cache_array[index].data, block_size_byte);
+    get_data_at(get_index(address), find_way(address), new_data);
   }
 
-  void get_data_at_index(uint32_t index, uint8_t* new_data) {
-    memcpy(new_data, cache_array[index].data, block_size_byte);
+  void get_data_at(uint32_t index, uint32_t way, uint8_t* new_data) {
+    memcpy(new_data, get_line_data(get_line(index, way)), block_size_byte);
   }
 
-  uint32_t get_address(uint32_t address){
-    uint32_t index = get_index(address);
-    uint32_t tag   = cache_array[index].tag;
-    uint32_t new_address = (tag << (nbits_index+nbits_blocks)) | (index<<nbits_blocks); //<<2 as words
+  uint32_t get_address_at(uint32_t index, uint32_t way){
+    uint32_t tag   = tag_array[get_line(index, way)] >> LINE_TAG_SHIFT;
+    uint32_t new_address = (tag << (nbits_index+nbits_blocks)) | (index<<nbits_blocks);
     return new_address;
   }
 
-  uint32_t get_address_at_index(uint32_t index){
-    uint32_t tag   = cache_array[index].tag;
-    uint32_t new_address = tag << (nbits_index+nbits_blocks) | (index<<nbits_blocks); //<<2 as words
-    return new_address;
+  // the address must hit, way is the one returned by find_way
+  int32_t get_word(uint32_t address, int way) {
+    int32_t data_word;
+    uint32_t index = get_index(address);
+    memcpy(&data_word, get_line_data(get_line(index, way)) + get_block_offset(address), sizeof(data_word));
+    touch(index, way);
+    return data_word;
   }
 
   int32_t get_word(uint32_t address) {
-    int32_t data_word = 0;
-    uint32_t block_offset = this->get_block_offset(address);
-    uint8_t* new_data = new uint8_t[block_size_byte];
-    this->get_data(address, new_data);
-    data_word = *((int32_t *)&new_data[block_offset]);
-    delete new_data;
-    return data_word;
+    return get_word(address, find_way(address));
+  }
+
+  // the address must hit, the line becomes dirty
+  void set_word(uint32_t address, int way, int32_t data_word) {
+    uint32_t index = get_index(address);
+    uint32_t line  = get_line(index, way);
+    memcpy(get_line_data(line) + get_block_offset(address), &data_word, sizeof(data_word));
+    tag_array[line] |= LINE_DIRTY;
+    touch(index, way);
   }
 
   void set_word(uint32_t address, int32_t data_word) {
-    uint32_t block_offset = this->get_block_offset(address);
-    uint8_t* new_data = new uint8_t[block_size_byte];
-    this->get_data(address, new_data);
-    *((int32_t *)&new_data[block_offset]) = data_word;
-    for(int i=0;i<block_size_byte;i++)
-    this->add_entry(address, new_data);
-    delete new_data;
+    set_word(address, find_way(address), data_word);
   }
 
-  bool is_entry_valid(uint32_t address) {
-    uint32_t index = get_index(address);
-    return cache_array[index].valid;
+  bool is_entry_valid_at(uint32_t index, uint32_t way) {
+    return (tag_array[get_line(index, way)] & LINE_VALID) != 0;
   }
 
-  bool is_entry_valid_at_index(uint32_t index) {
-    return cache_array[index].valid;
+  bool is_entry_dirty_at(uint32_t index, uint32_t way) {
+    return (tag_array[get_line(index, way)] & LINE_DIRTY) != 0;
+  }
+
+  void clean_entry_at(uint32_t index, uint32_t way) {
+    tag_array[get_line(index, way)] &= ~(uint32_t)LINE_DIRTY;
   }
 
   void print_cache_status(uint32_t operation_id, std::string time_str) {
     if (cacheFile.is_open()) {
-      std::string log_cache = "";
-      std::ostringstream ss;
-
-      log_cache+= std::to_string(operation_id) + "):  " + time_str + "\n";
-      log_cache+= "INDEX | TAG | DATA BLOCK | VALID\n";
-
-      for(int i=0;i<number_of_blocks;i++) {
-        ss << "0x" << std::setw(this->nbits_index/4) << std::setfill('0') << std::hex << static_cast<uint32_t>(i);
-        log_cache+= ss.str() + " | ";
-        ss.str("");
-        ss.clear();
-        ss << "0x" << std::setw(this->nbits_tags/4) << std::setfill('0') << std::hex << cache_array[i].tag;
-        log_cache+= ss.str() + " | 0x";
-        ss.str("");
-        ss.clear();
-        for(int j = 0; j<block_size_byte; j++)
-          ss << ":" << std::setw(2) << std::setfill('0') << std::hex << static_cast<uint16_t>(cache_array[i].data[j]);
-        log_cache+= ss.str() + " | ";
-        log_cache+= std::string( cache_array[i].valid ? "1" : "0" ) + "\n";
-
-        cacheFile << log_cache;
-        ss.str("");
-        ss.clear();
-        log_cache = std::string("");
+      // the whole cache is formatted in one buffer and written at once
+      std::string log_cache = std::to_string(operation_id) + "):  " + time_str + "\n";
+      log_cache += "INDEX | WAY | TAG | DATA BLOCK | VALID | DIRTY\n";
+      log_cache.reserve(log_cache.size() + number_of_blocks * (48 + 3*block_size_byte));
+      char field[32];
+
+      for(uint32_t i=0;i<number_of_sets;i++) {
+        for(uint32_t w=0;w<number_of_ways;w++) {
+          uint32_t line = get_line(i, w);
+          snprintf(field, sizeof(field), "0x%0*x | %u | 0x%0*x | 0x", (int)this->nbits_index/4, i, w,
+                   (int)this->nbits_tags/4, tag_array[line] >> LINE_TAG_SHIFT);
+          log_cache += field;
+          for(uint32_t j = 0; j<block_size_byte; j++) {
+            snprintf(field, sizeof(field), ":%02x", get_line_data(line)[j]);
+            log_cache += field;
+          }
+          log_cache += is_entry_valid_at(i, w) ? " | 1 | " : " | 0 | ";
+          log_cache += is_entry_dirty_at(i, w) ? "1\n" : "0\n";
+        }
       }
+      cacheFile << log_cache;
     } else {
       std::cout << "Failed to create the Cache file." << std::endl;
     }
@@ -202,7 +313,7 @@ public:
     0x7052 = 'b111_0000_0101_0010'
 
     cache size = 4KB,
-    number_of_blocks = 256, thus index is on 8bit
+    number_of_sets = 256 (direct mapped), thus index is on 8bit
     block_size_in_byte = 4KB/256 = 16bytes, i.e. 4 words
 
     111:       tag
@@ -0,0 +1,192 @@
+#ifndef CACHESTATISTICS_H
+#define CACHESTATISTICS_H
+
+#include <stdint.h>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Statistics of the cache of the SystemC external memory.
+// Misses are classified with the 3C model: a compulsory miss is the first
+// access to a line, a capacity miss would also miss in a fully-associative
+// LRU cache with the same number of lines, the other misses are conflicts.
+class CacheStatistics
+{
+
+  public:
+    typedef struct region_statistics {
+      uint64_t accesses;
+      uint64_t hits;
+      uint64_t misses;
+    } region_statistics_t;
+
+    uint32_t number_of_transactions;
+    uint32_t number_of_hit;
+    uint32_t number_of_miss;
+    uint64_t number_of_reads;
+    uint64_t number_of_writes;
+    uint64_t compulsory_misses;
+    uint64_t capacity_misses;
+    uint64_t conflict_misses;
+    uint64_t writebacks;
+    uint64_t flushes;
+    uint64_t bypass_accesses;
+    uint64_t bytes_read;       // from the main memory
+    uint64_t bytes_written;    // to the main memory
+    double   total_latency_ns; // from the OBI request to its rvalid
+    uint64_t latency_samples;
+
+    CacheStatistics()
+    {
+      reset(256, 16, 4096);
+    }
+
+    // number_of_blocks and block_size_byte must be the geometry of the cache,
+    // the heatmap counts the accesses per region of region_size_byte bytes
+    void reset(uint32_t number_of_blocks, uint32_t block_size_byte, uint32_t region_size_byte)
+    {
+      number_of_transactions = 0;
+      number_of_hit          = 0;
+      number_of_miss         = 0;
+      number_of_reads        = 0;
+      number_of_writes       = 0;
+      compulsory_misses      = 0;
+      capacity_misses        = 0;
+      conflict_misses        = 0;
+      writebacks             = 0;
+      flushes                = 0;
+      bypass_accesses        = 0;
+      bytes_read             = 0;
+      bytes_written          = 0;
+      total_latency_ns       = 0;
+      latency_samples        = 0;
+
+      this->number_of_blocks = number_of_blocks;
+      this->block_size_byte  = block_size_byte;
+      this->region_size_byte = region_size_byte;
+      seen_lines.clear();
+      lru_lines.clear();
+      lru_position.clear();
+      regions.clear();
+    }
+
+    // to be called for every request served by the cache, after the cache lookup
+    void access(uint32_t address, bool write, bool hit)
+    {
+      uint32_t line = address / block_size_byte;
+      bool     fully_associative_hit = touch_fully_associative(line);
+
+      if (write) number_of_writes++;
+      else number_of_reads++;
+
+      region_statistics_t& region = regions[address / region_size_byte];
+      region.accesses++;
+
+      if (hit) {
+        number_of_hit++;
+        region.hits++;
+        return;
+      }
+
+      number_of_miss++;
+      region.misses++;
+      if (seen_lines.insert(line).second)
+        compulsory_misses++;
+      else if (fully_associative_hit)
+        conflict_misses++;
+      else
+        capacity_misses++;
+    }
+
+    void bypass_access(uint32_t address, bool write)
+    {
+      if (write) number_of_writes++;
+      else number_of_reads++;
+      bypass_accesses++;
+      regions[address / region_size_byte].accesses++;
+    }
+
+    void latency(double latency_ns)
+    {
+      total_latency_ns += latency_ns;
+      latency_samples++;
+    }
+
+    void write_json(const std::string& file)
+    {
+      std::ofstream json(file);
+
+      json << std::fixed << std::setprecision(3);
+      json << "{\n";
+      json << "  \"cache\": {\"lines\": " << number_of_blocks << ", \"line_size\": " << block_size_byte << "},\n";
+      json << "  \"transactions\": " << number_of_reads + number_of_writes << ",\n";
+      json << "  \"reads\": " << number_of_reads << ",\n";
+      json << "  \"writes\": " << number_of_writes << ",\n";
+      json << "  \"hits\": " << number_of_hit << ",\n";
+      json << "  \"misses\": " << number_of_miss << ",\n";
+      json << "  \"hit_rate\": " << hit_rate() << ",\n";
+      json << "  \"compulsory_misses\": " << compulsory_misses << ",\n";
+      json << "  \"capacity_misses\": " << capacity_misses << ",\n";
+      json << "  \"conflict_misses\": " << conflict_misses << ",\n";
+      json << "  \"writebacks\": " << writebacks << ",\n";
+      json << "  \"flushes\": " << flushes << ",\n";
+      json << "  \"bypass_accesses\": " << bypass_accesses << ",\n";
+      json << "  \"bytes_read\": " << bytes_read << ",\n";
+      json << "  \"bytes_written\": " << bytes_written << ",\n";
+      json << "  \"avg_latency_ns\": " << average_latency_ns() << ",\n";
+      json << "  \"region_size\": " << region_size_byte << ",\n";
+      json << "  \"regions\": [\n";
+      for (std::map<uint32_t, region_statistics_t>::const_iterator it = regions.begin(); it != regions.end(); ++it) {
+        json << "    {\"start\": \"0x" << std::hex << std::setw(8) << std::setfill('0') << it->first * region_size_byte
+             << std::dec << std::setfill(' ') << "\", \"accesses\": " << it->second.accesses << ", \"hits\": " << it->second.hits
+             << ", \"misses\": " << it->second.misses << "}" << (std::next(it) == regions.end() ? "" : ",") << "\n";
+      }
+      json << "  ]\n}\n";
+    }
+
+    double hit_rate() const
+    {
+      return number_of_hit + number_of_miss == 0 ? 0.0 : (double)number_of_hit / (number_of_hit + number_of_miss);
+    }
+
+    double average_latency_ns() const
+    {
+      return latency_samples == 0 ? 0.0 : total_latency_ns / latency_samples;
+    }
+
+  private:
+    // moves line to the front of the fully-associative LRU cache, returns whether it was there
+    bool touch_fully_associative(uint32_t line)
+    {
+      std::unordered_map<uint32_t, std::list<uint32_t>::iterator>::iterator it = lru_position.find(line);
+      if (it != lru_position.end()) {
+        lru_lines.splice(lru_lines.begin(), lru_lines, it->second);
+        return true;
+      }
+      lru_lines.push_front(line);
+      lru_position[line] = lru_lines.begin();
+      if (lru_lines.size() > number_of_blocks) {
+        lru_position.erase(lru_lines.back());
+        lru_lines.pop_back();
+      }
+      return false;
+    }
+
+    uint32_t number_of_blocks;
+    uint32_t block_size_byte;
+    uint32_t region_size_byte;
+
+    std::unordered_set<uint32_t> seen_lines;
+    std::list<uint32_t>          lru_lines;  // most recently used first
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> lru_position;
+    std::map<uint32_t, region_statistics_t> regions;
+
+};
+
+#endif
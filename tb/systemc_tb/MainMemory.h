@@ -12,16 +12,29 @@ using namespace std;
 #include "tlm.h"
 #include "tlm_utils/simple_target_socket.h"
 
+#include "XHEEP_FirmwareLoader.hh"
 
-// Target module representing a simple direct mapped cache
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <iostream>
+
+
+// Target module representing the main memory behind the cache
 SC_MODULE(MainMemory)
 {
   // TLM-2 socket, defaults to 32-bits wide, base protocol
   tlm_utils::simple_target_socket<MainMemory> socket;
 
-  enum { SIZE = 32*1024/4 }; //32KB word addressable
+  enum { DEFAULT_SIZE = 32*1024 }; //32KB
 
-  int32_t mem[SIZE];
+  // byte addressable, either allocated on the heap or mapped on a backing file
+  uint8_t*      mem = NULL;
+  sc_dt::uint64 size_byte = 0;
+  bool          mapped = false;
+  bool          dmi_granted = false;
 
 
   SC_CTOR(MainMemory)
@@ -29,40 +42,186 @@ SC_MODULE(MainMemory)
   {
     // Register callback for incoming b_transport interface method call
     socket.register_b_transport(this, &MainMemory::b_transport);
+    socket.register_get_direct_mem_ptr(this, &MainMemory::get_direct_mem_ptr);
+
+    configure(DEFAULT_SIZE, "");
+  }
+
+  ~MainMemory()
+  {
+    release();
+  }
+
+  // Allocates size bytes of memory (a power of 2, so that the address offset is a mask).
+  // With a backing file the memory is mmap-ed on it: the file is created or extended to size bytes
+  // and keeps its content across simulations. Otherwise the memory is filled with random data
+  bool configure(sc_dt::uint64 size, const std::string& backing_file)
+  {
+    if (size < 8 || (size & (size - 1)) != 0) {
+      std::cout << "[TESTBENCH]: ERROR: the SystemC main memory size must be a power of 2, got " << size << std::endl;
+      return false;
+    }
+
+    release();
+
+    if (!backing_file.empty()) {
+      int fd = open(backing_file.c_str(), O_RDWR | O_CREAT, 0644);
+      struct stat st;
+      if (fd < 0 || fstat(fd, &st) != 0 || ((sc_dt::uint64)st.st_size < size && ftruncate(fd, size) != 0)) {
+        std::cout << "[TESTBENCH]: ERROR: cannot open the SystemC main memory file " << backing_file << std::endl;
+        if (fd >= 0) close(fd);
+        return false;
+      }
+      void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      // the mapping stays valid once the file is closed
+      close(fd);
+      if (ptr == MAP_FAILED) {
+        std::cout << "[TESTBENCH]: ERROR: cannot map the SystemC main memory file " << backing_file << std::endl;
+        return false;
+      }
+      mem    = (uint8_t*)ptr;
+      mapped = true;
+    } else {
+      mem    = new uint8_t[size];
+      mapped = false;
+      // Initialize memory with random data
+      for (sc_dt::uint64 i = 0; i < size / 4; i++)
+        ((int32_t*)mem)[i] = 0xAA000000 | (rand() % 256);
+    }
+    size_byte = size;
+
+    invalidate_dmi();
+    return true;
+  }
+
+  // Initializes the memory from an image: objcopy verilog hex files (.hex) and ELF files are placed at
+  // their address modulo the memory size, any other file is a raw binary copied from address 0
+  bool load_image(const std::string& file)
+  {
+    if (file.size() > 4 && (file.compare(file.size() - 4, 4, ".hex") == 0 || file.compare(file.size() - 4, 4, ".elf") == 0)) {
+      XHEEP_FirmwareLoader loader;
+      if (!loader.load(file)) return false;
+      unsigned int nwords = loader.write([this](uint32_t addr, uint32_t word) {
+        memcpy(&mem[addr & (size_byte - 1)], &word, 4);
+        return true;
+      });
+      std::cout << "[TESTBENCH]: Loaded " << nwords << " words of " << file << " in the SystemC main memory" << std::endl;
+      return true;
+    }
+
+    std::ifstream image(file, std::ios::binary);
+    if (!image.is_open()) {
+      std::cout << "[TESTBENCH]: ERROR: cannot open the SystemC main memory image " << file << std::endl;
+      return false;
+    }
+    image.read(reinterpret_cast<char*>(mem), size_byte);
+    std::cout << "[TESTBENCH]: Loaded " << image.gcount() << " bytes of " << file << " in the SystemC main memory" << std::endl;
+    if (!image.eof() && image.peek() != EOF)
+      std::cout << "[TESTBENCH]: WARNING: " << file << " is larger than the SystemC main memory, it was truncated" << std::endl;
+    return true;
+  }
+
+  // Writes the whole memory in a raw binary file
+  bool dump(const std::string& file)
+  {
+    std::ofstream dump_file(file, std::ios::binary);
+    if (!dump_file.is_open()) {
+      std::cout << "[TESTBENCH]: ERROR: cannot write the SystemC main memory dump " << file << std::endl;
+      return false;
+    }
+    dump_file.write(reinterpret_cast<const char*>(mem), size_byte);
+    std::cout << "[TESTBENCH]: Dumped the SystemC main memory in " << file << std::endl;
+    return true;
+  }
 
-    // Initialize memory with random data
-    for (int i = 0; i < SIZE; i++)
-      mem[i] = 0xAA000000 | (rand() % 256);
+  void release()
+  {
+    if (mem == NULL) return;
+    if (mapped) {
+      msync(mem, size_byte, MS_SYNC);
+      munmap(mem, size_byte);
+    } else {
+      delete[] mem;
+    }
+    mem = NULL;
   }
 
+  // Latency annotated on each transaction: a burst pays the access latency once
+  // and then one beat per additional word
+  sc_time access_latency = sc_time(50, SC_NS);
+  sc_time beat_latency   = sc_time(10, SC_NS);
+
   // TLM-2 blocking transport method
   virtual void b_transport( tlm::tlm_generic_payload& trans, sc_time& delay )
   {
     tlm::tlm_command cmd = trans.get_command();
-    sc_dt::uint64    adr = trans.get_address() / 4;
+    sc_dt::uint64    adr = trans.get_address();
     unsigned char*   ptr = trans.get_data_ptr();
     unsigned int     len = trans.get_data_length();
     unsigned char*   byt = trans.get_byte_enable_ptr();
+    unsigned int     bel = trans.get_byte_enable_length();
     unsigned int     wid = trans.get_streaming_width();
+    unsigned char*   mem_bytes = mem;
 
-    // Obliged to check address range and check for unsupported features,
-    //   i.e. byte enables, streaming, and bursts
-    // Can ignore DMI hint and extensions
-    // Using the SystemC report handler is an acceptable way of signalling an error
+    // Bursts of any length, streaming (the address wraps every wid bytes) and byte enables are supported
+    // Can ignore extensions
 
-    if (adr >= sc_dt::uint64(SIZE) || byt != 0 || len > 4 || wid < len)
-      SC_REPORT_ERROR("TLM-2", "Target does not support given generic payload transaction");
+    if (len == 0 || wid == 0 || (byt != 0 && bel == 0)) {
+      trans.set_response_status( tlm::TLM_GENERIC_ERROR_RESPONSE );
+      return;
+    }
+    if (adr + (wid < len ? wid : len) > size_byte) {
+      trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+      return;
+    }
 
     // Obliged to implement read and write commands
-    if ( cmd == tlm::TLM_READ_COMMAND )
-      memcpy(ptr, &mem[adr], len);
-    else if ( cmd == tlm::TLM_WRITE_COMMAND )
-      memcpy(&mem[adr], ptr, len);
+    if (byt == 0 && wid >= len) {
+      if ( cmd == tlm::TLM_READ_COMMAND )
+        memcpy(ptr, &mem_bytes[adr], len);
+      else if ( cmd == tlm::TLM_WRITE_COMMAND )
+        memcpy(&mem_bytes[adr], ptr, len);
+    } else {
+      for (unsigned int i = 0; i < len; i++) {
+        if (byt != 0 && byt[i % bel] != tlm::TLM_BYTE_ENABLED) continue;
+        if ( cmd == tlm::TLM_READ_COMMAND )
+          ptr[i] = mem_bytes[adr + i % wid];
+        else if ( cmd == tlm::TLM_WRITE_COMMAND )
+          mem_bytes[adr + i % wid] = ptr[i];
+      }
+    }
+
+    delay += access_latency + beat_latency * ((len + 3) / 4 - 1);
+
+    // The whole memory can be accessed directly
+    trans.set_dmi_allowed( true );
 
     // Obliged to set response status to indicate successful completion
     trans.set_response_status( tlm::TLM_OK_RESPONSE );
   }
 
+  // TLM-2 forward DMI method, grants read/write access to the whole memory.
+  // The DMI latency is the access latency, the initiator adds beat_latency for each additional word
+  virtual bool get_direct_mem_ptr( tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi_data )
+  {
+    dmi_data.allow_read_write();
+    dmi_data.set_dmi_ptr( mem );
+    dmi_data.set_start_address( 0 );
+    dmi_data.set_end_address( size_byte - 1 );
+    dmi_data.set_read_latency( access_latency );
+    dmi_data.set_write_latency( access_latency );
+    dmi_granted = true;
+    return true;
+  }
+
+  // Must be called whenever the memory buffer changes, so that initiators drop their pointers
+  void invalidate_dmi()
+  {
+    if (!dmi_granted) return;
+    socket->invalidate_direct_mem_ptr(0, (sc_dt::uint64)-1);
+    dmi_granted = false;
+  }
+
 };
 
 #endif
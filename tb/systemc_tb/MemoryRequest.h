@@ -10,11 +10,14 @@ using namespace std;
 #include "tlm_utils/simple_initiator_socket.h"
 
 #include "Cache.h"
+#include "TransactionLog.h"
+#include "CacheStatistics.h"
 
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <vector>
 
 // MemoryRequest module generating generic payload transactions
 
@@ -22,219 +25,299 @@ SC_MODULE(MemoryRequest)
 {
   // TLM-2 socket, defaults to 32-bits wide, base protocol
   tlm_utils::simple_initiator_socket<MemoryRequest> socket;
-  bool                                          we_i;
-  uint32_t                                      be_i;
-  uint32_t                                      addr_i;
-  uint32_t                                      rwdata_io;
   CacheMemory*                                  cache;
-  std::ofstream                                 heep_mem_transactions;
+  TransactionLog*                               heep_mem_transactions;
   bool                                          bypass_state = false;
+  // offset of an address in the main memory, whose size is a power of 2
+  uint32_t                                      mem_addr_mask = 0x00007FFF;
+  // direct memory interface to the main memory, used when use_dmi is set
+  bool                                          use_dmi = false;
+  bool                                          dmi_ptr_valid = false;
+  tlm::tlm_dmi                                  dmi_data;
+  // the DMI latency is the access latency of the memory, each additional word of a burst
+  // costs dmi_beat_latency on top of it so that DMI only changes the host time, not the timing
+  sc_time                                       dmi_beat_latency = SC_ZERO_TIME;
+
+  // TLM-2 generic payload transaction, reused across calls to b_transport
+  tlm::tlm_generic_payload*                     trans;
+  std::vector<uint8_t>                          line_buffer;
+  std::vector<int32_t>                          main_mem_buffer;
+
+  // latency of a hit, and of a miss on top of the time taken by the main memory
+  sc_time                                       hit_latency = sc_time(20, SC_NS);
+  sc_time                                       miss_latency = sc_time(100, SC_NS);
+  // end of the main memory transactions of the last miss
+  sc_time                                       main_memory_free = SC_ZERO_TIME;
+
+  CacheStatistics                               cache_stat;
+  // bytes of the address regions of the statistics heatmap
+  uint32_t                                      stats_region_size = 4096;
+
+  // replaces the default direct-mapped cache, to be called before the simulation starts
+  bool configure_cache(uint32_t number_of_sets, uint32_t number_of_ways, uint32_t block_size_byte, const std::string& replacement) {
+    CacheMemory::replacement_policy_t replacement_policy;
+    if (!CacheMemory::get_replacement_policy(replacement, replacement_policy)) {
+      std::cout << "Cache replacement policy " << replacement << " not supported (lru, plru, random)" << std::endl;
+      return false;
+    }
+    // the old cache is deleted first as it owns cache_status.log
+    delete cache;
+    cache = new CacheMemory;
+    if (!cache->create_cache(number_of_sets, number_of_ways, block_size_byte, replacement_policy))
+      return false;
+    cache->initialize_cache();
+    cache_stat.reset(cache->number_of_blocks, cache->get_block_size(), stats_region_size);
+    if (heep_mem_transactions->enabled(LOG_LEVEL_STATUS))
+      cache->print_cache_status(cache_stat.number_of_transactions, sc_time_stamp().to_string());
+    cache_stat.number_of_transactions++;
+    std::cout << "[TESTBENCH]: SystemC cache of " << cache->cache_size_byte << " bytes: " << number_of_sets << " sets, "
+              << number_of_ways << " ways, " << block_size_byte << " bytes per line, " << replacement << " replacement" << std::endl;
+    return true;
+  }
 
-  typedef struct cache_statistics
-  {
-    uint32_t number_of_transactions;
-    uint32_t number_of_hit;
-    uint32_t number_of_miss;
-  } cache_statistics_t;
-
-  cache_statistics_t cache_stat;
+  // the transactions are logged in heep_mem_transactions.bin, see TransactionLog.h
+  bool set_log_level(log_level_t level) {
+    if (!heep_mem_transactions->open("heep_mem_transactions.bin", level)) {
+      std::cout << "[TESTBENCH]: ERROR: cannot open heep_mem_transactions.bin" << std::endl;
+      return false;
+    }
+    return true;
+  }
 
   SC_CTOR(MemoryRequest)
-  : socket("socket"),  // Construct and name socket
-    heep_mem_transactions("heep_mem_transactions.log")
+  : socket("socket")  // Construct and name socket
   {
+    heep_mem_transactions = new TransactionLog;
+    set_log_level(LOG_LEVEL_EVENTS);
+
+    socket.register_invalidate_direct_mem_ptr(this, &MemoryRequest::invalidate_direct_mem_ptr);
 
     cache = new CacheMemory;
     cache->create_cache();
     cache->initialize_cache();
-    cache_stat.number_of_transactions = 0;
-    cache_stat.number_of_hit = 0;
-    cache_stat.number_of_miss = 0;
-    cache->print_cache_status(cache_stat.number_of_transactions++, sc_time_stamp().to_string());
+    cache_stat.reset(cache->number_of_blocks, cache->get_block_size(), stats_region_size);
 
-    SC_THREAD(thread_process);
+    trans = new tlm::tlm_generic_payload;
   }
 
 
-  uint32_t memory_copy(uint32_t addr, int32_t* buffer_data, int N, bool write_enable, tlm::tlm_generic_payload* trans, sc_time delay) {
+  // TLM-2 backward DMI method
+  virtual void invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range)
+  {
+    dmi_ptr_valid = false;
+  }
+
+  // Moves N words between buffer_data and the main memory with a single burst transaction,
+  // or with a memcpy when a DMI pointer covers it; the latency annotated by the memory is accumulated in delay
+  uint32_t memory_copy(uint32_t addr, int32_t* buffer_data, int N, bool write_enable, tlm::tlm_generic_payload* trans, sc_time& delay) {
 
     tlm::tlm_command cmd = write_enable ? tlm::TLM_WRITE_COMMAND : tlm::TLM_READ_COMMAND;
-
-    //first read block_size bytes from memory to place them in cache regardless of the cmd
-    for(int i=0; i < N; i++){
+    uint32_t mem_addr = addr & mem_addr_mask;
+
+    if (dmi_ptr_valid && mem_addr >= dmi_data.get_start_address() && mem_addr + N*4 - 1 <= dmi_data.get_end_address() &&
+        (write_enable ? dmi_data.is_write_allowed() : dmi_data.is_read_allowed())) {
+      unsigned char* dmi_ptr = dmi_data.get_dmi_ptr() + (mem_addr - dmi_data.get_start_address());
+      if (write_enable) {
+        memcpy(dmi_ptr, buffer_data, N*4);
+        delay += dmi_data.get_write_latency() + dmi_beat_latency * (N - 1);
+      } else {
+        memcpy(buffer_data, dmi_ptr, N*4);
+        delay += dmi_data.get_read_latency() + dmi_beat_latency * (N - 1);
+      }
+    } else {
       trans->set_command( cmd );
-      trans->set_address( (addr + i*4) & 0x00007FFF ); //15bits
-      trans->set_data_ptr( reinterpret_cast<unsigned char*>(&buffer_data[i]) );
-      trans->set_data_length( 4 );
-      trans->set_streaming_width( 4 ); // = data_length to indicate no streaming
+      trans->set_address( mem_addr );
+      trans->set_data_ptr( reinterpret_cast<unsigned char*>(buffer_data) );
+      trans->set_data_length( N*4 );
+      trans->set_streaming_width( N*4 ); // = data_length to indicate no streaming
       trans->set_byte_enable_ptr( 0 ); // 0 indicates unused
       trans->set_dmi_allowed( false ); // Mandatory initial value
       trans->set_response_status( tlm::TLM_INCOMPLETE_RESPONSE ); // Mandatory initial value
       socket->b_transport( *trans, delay );  // Blocking transport call
 
-      if(bypass_state){
-        if(write_enable)
-          heep_mem_transactions << "Writing to Mem[" << hex << ((addr + i*4) & 0x00007FFF) << "]: " << buffer_data[i] << " at time " << sc_time_stamp() <<std::endl;
-        else
-          heep_mem_transactions << "Reading from Mem[" << hex << ((addr + i*4) & 0x00007FFF) << "]: " << buffer_data[i] << " at time " << sc_time_stamp() <<std::endl;
-      } else {
-        if(write_enable)
-          heep_mem_transactions << "Cache Writing to Mem[" << hex << ((addr + i*4) & 0x00007FFF) << "]: " << buffer_data[i] << " at time " << sc_time_stamp() <<std::endl;
-        else
-          heep_mem_transactions << "Cache Reading from Mem[" << hex << ((addr + i*4) & 0x00007FFF) << "]: " << buffer_data[i] << " at time " << sc_time_stamp() <<std::endl;
-      }
       // Initiator obliged to check response status and delay
       if ( trans->is_response_error() )
         SC_REPORT_ERROR("TLM-2", "Response error from b_transport");
+
+      // ask for a DMI pointer the first time the target allows it
+      if ( use_dmi && trans->is_dmi_allowed() ) {
+        dmi_data.init();
+        dmi_ptr_valid = socket->get_direct_mem_ptr( *trans, dmi_data );
+      }
+    }
+
+    if (write_enable)
+      cache_stat.bytes_written += N*4;
+    else
+      cache_stat.bytes_read += N*4;
+
+    if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS)) {
+      for(int i=0; i < N; i++)
+        heep_mem_transactions->log(write_enable ? LOG_MEM_WRITE : LOG_MEM_READ, (addr + i*4) & mem_addr_mask, buffer_data[i], 0, bypass_state);
     }
     return N;
   }
 
 
-  void thread_process()
-  {
-    // TLM-2 generic payload transaction, reused across calls to b_transport
-    tlm::tlm_generic_payload* trans = new tlm::tlm_generic_payload;
-
-    sc_time delay_gnt_miss = sc_time(100, SC_NS);
-    sc_time delay_rvalid_miss = sc_time(100, SC_NS);
+  // Writes back the dirty lines of the cache, returns the number of lines written
+  uint32_t flush_cache(tlm::tlm_generic_payload* trans, sc_time& delay) {
+    uint8_t* cache_data = new uint8_t[cache->get_block_size()];
+    uint32_t cache_flushed = 0;
+    for(int i=0;i<cache->number_of_sets;i++){
+      for(int w=0;w<cache->number_of_ways;w++){
+        //only the dirty entries have to be written back
+        if (cache->is_entry_valid_at(i, w) && cache->is_entry_dirty_at(i, w)) {
+          cache_flushed++;
+          cache_stat.writebacks++;
+          cache->get_data_at(i, w, cache_data);
+          //write back
+          memory_copy(cache->get_address_at(i, w), (int32_t *)cache_data, cache->get_block_size()/4, true, trans, delay);
+          cache->clean_entry_at(i, w);
+        }
+      }
+    }
+    delete[] cache_data;
+    return cache_flushed;
+  }
 
-    sc_time delay_rvalid_hit = sc_time(20, SC_NS); //as of today, it must be >=20
+  // Makes the main memory up to date at the end of the simulation, e.g. before dumping it
+  void write_back_cache() {
+    tlm::tlm_generic_payload trans;
+    sc_time delay = SC_ZERO_TIME;
+    flush_cache(&trans, delay);
+  }
 
-    sc_time delay = sc_time(1, SC_NS);
+  // Serves one OBI request accepted at the current time, without waiting: returns in rwdata the read data
+  // and the time it takes to have the response. The cache lookup overlaps with the main memory transactions
+  // of previous misses, while the main memory serves one miss at a time
+  sc_time serve_request(bool we, uint32_t be, uint32_t addr, uint32_t& rwdata)
+  {
+    //latency of the main memory transactions of the current request, as annotated by the memory
+    sc_time delay = SC_ZERO_TIME;
+    sc_time now = sc_time_stamp();
+    sc_time latency;
 
-    uint32_t cache_block_size_byte = cache->get_block_size();
     uint32_t cache_block_size_word = cache->get_block_size()/4;
-    uint8_t* cache_data = new uint8_t[cache_block_size_byte];
-    int32_t* main_mem_data = new int32_t[cache_block_size_word];
+    line_buffer.resize(cache->get_block_size());
+    main_mem_buffer.resize(cache_block_size_word);
+    uint8_t* cache_data = line_buffer.data();
+    int32_t* main_mem_data = main_mem_buffer.data();
     uint32_t address_to_replace;
     uint32_t cache_flushed;
 
-    while(true) {
-
-      wait(obi_new_req);
+    if (heep_mem_transactions->enabled(LOG_LEVEL_OBI))
+      heep_mem_transactions->log(LOG_REQ, addr, rwdata, be, we);
 
-      heep_mem_transactions << "X-HEEP tlm_generic_payload REQ: { " << (we_i ? 'W' : 'R') << ", @0x" << hex << addr_i
-                << " , DATA = 0x" << hex << rwdata_io << " BE = " << hex << be_i <<", at time " << sc_time_stamp() << " }" << std::endl;
-
-      if(be_i!=0xF) {
-        SC_REPORT_ERROR("OBI External Memory SystemC", "ByteEnable different than 0xF is not supported");
-      }
+    if(be!=0xF) {
+      SC_REPORT_ERROR("OBI External Memory SystemC", "ByteEnable different than 0xF is not supported");
+    }
 
-      //if we are writing 1 or 2 to last address, flush cache or bypass
-      if(we_i && ((addr_i & 0x00007FFF) == 0x7FFC)){
-
-        if(rwdata_io == 1){
-          //FLUSH Cache
-          heep_mem_transactions << "X-HEEP Flush Cache, at time " << sc_time_stamp() << " }" << std::endl;
-          uint32_t cache_number_of_blocks = cache->number_of_blocks;
-          heep_mem_transactions<<"Cache Flushing at time "<<sc_time_stamp()<<std::endl;
-          cache_flushed=0;
-          for(int i=0;i<cache_number_of_blocks;i++){
-              if (cache->is_entry_valid_at_index(i)) {
-                cache_flushed++;
-                //if we are going to replace a valid entry
-                cache->get_data_at_index(i, cache_data);
-                address_to_replace = cache->get_address_at_index(i);
-                //write back
-                memory_copy(address_to_replace, (uint32_t *)cache_data, cache_block_size_word, true, trans, delay);
-            }
-          }
-          heep_mem_transactions<<"Cache Flushed "<< dec << cache_flushed << " entries"<<std::endl;
-        } else if (rwdata_io == 2){
-          //ByPass Flash from next transaction
-          bypass_state = true;
-          heep_mem_transactions<<"Cache ByPass set at time "<<sc_time_stamp()<<std::endl;
-          heep_mem_transactions << "X-HEEP Bypass Cache, at time " << sc_time_stamp() << " }" << std::endl;
-        }
-        obi_new_gnt.notify();
-        wait(delay_rvalid_miss);
+    //if we are writing 1 or 2 to last address, flush cache or bypass
+    if(we && ((addr & mem_addr_mask) == mem_addr_mask - 3)){
+
+      if(rwdata == 1){
+        //FLUSH Cache
+        if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+          heep_mem_transactions->log(LOG_FLUSH, addr);
+        cache_stat.flushes++;
+        cache_flushed = flush_cache(trans, delay);
+        if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+          heep_mem_transactions->log(LOG_FLUSHED, addr, 0, cache_flushed);
+      } else if (rwdata == 2){
+        //ByPass Flash from next transaction
+        bypass_state = true;
+        if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+          heep_mem_transactions->log(LOG_BYPASS_SET, addr);
       }
+      latency = main_memory_latency(now, hit_latency, delay);
+    }
 
-      else{
-
-        if (bypass_state) {
-          heep_mem_transactions << "Cache in bypass state at time " << sc_time_stamp() <<std::endl;
-          wait(delay_gnt_miss);
-          obi_new_gnt.notify();
-          memory_copy(addr_i, &rwdata_io, 1, we_i == true, trans, delay);
-          wait(delay_rvalid_miss);
-        } else {
-          // we use the cache only to read
-          if(cache->cache_hit(addr_i)){
-
-            heep_mem_transactions << "Cache HIT on address " << hex << addr_i << " at time " << sc_time_stamp() <<std::endl;
-
-            cache_stat.number_of_hit++;
-
-            obi_new_gnt.notify();
-            main_mem_data[0] = cache->get_word(addr_i);
-            //if Write, writes to cache
-            if(we_i)
-              cache->set_word(addr_i, rwdata_io);
-            else
-              rwdata_io = main_mem_data[0];
-            wait(delay_rvalid_hit);
-          }
+    else if (bypass_state) {
+      if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+        heep_mem_transactions->log(LOG_BYPASS, addr);
+      cache_stat.bypass_access(addr, we);
+      memory_copy(addr, (int32_t *)&rwdata, 1, we, trans, delay);
+      latency = main_memory_latency(now, miss_latency, delay);
+    }
 
-          else { //miss case
+    else {
+      int hit_way = cache->find_way(addr);
+      cache_stat.access(addr, we, hit_way >= 0);
 
-            cache_stat.number_of_miss++;
+      if(hit_way >= 0){
 
-            heep_mem_transactions << "Cache MISS on address " << hex << addr_i << " at time " << sc_time_stamp() <<std::endl;
+        if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+          heep_mem_transactions->log(LOG_HIT, addr);
 
-            //wait some time before giving the gnt as we have a miss
-            wait(delay_gnt_miss);
-            obi_new_gnt.notify();
+        //the word is accessed in place in the cache line
+        if(we)
+          cache->set_word(addr, hit_way, rwdata);
+        else
+          rwdata = cache->get_word(addr, hit_way);
+        latency = hit_latency;
+      }
 
-            uint32_t addr_to_read = cache->get_base_address(addr_i);
-            uint32_t addr_offset  = cache->get_block_offset(addr_i);
+      else { //miss case
 
-            //first read block_size bytes from memory to place them in cache regardless of the cmd
-            memory_copy(addr_to_read, main_mem_data, cache_block_size_word, false, trans, delay);
-            uint32_t index_to_add = cache->get_index(addr_i);
-            uint32_t tag_to_add       = cache->get_tag(addr_i);
+        if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+          heep_mem_transactions->log(LOG_MISS, addr);
 
-            heep_mem_transactions << "Adding to Cache TAG " << hex << tag_to_add << " and index " << hex << index_to_add <<std::endl;
+        uint32_t addr_to_read = cache->get_base_address(addr);
+        uint32_t addr_offset  = cache->get_block_offset(addr);
 
-            //always write back what will be replace if valid as we do not have dirty bits for simplicity
-            if (cache->is_entry_valid(addr_i)) {
-              //if we are going to replace a valid entry
-              cache->get_data(addr_i, cache_data);
-              address_to_replace = cache->get_address(addr_i);
-              uint32_t index_to_replace = cache->get_index(addr_i);
-              uint32_t tag_to_replace = cache->get_tag_from_index(index_to_replace);
+        //first read block_size bytes from memory to place them in cache regardless of the cmd
+        memory_copy(addr_to_read, main_mem_data, cache_block_size_word, false, trans, delay);
+        uint32_t index_to_add = cache->get_index(addr);
+        uint32_t tag_to_add       = cache->get_tag(addr);
+        uint32_t way_to_add       = cache->get_victim_way(addr);
 
-              heep_mem_transactions << "Cache Replace address " << hex << addr_i << " with address " << hex << address_to_replace << " due to the MISS at time " << sc_time_stamp() <<std::endl;
-              heep_mem_transactions << "Index to replace " << hex << index_to_replace << " Tag to replace " << tag_to_replace <<std::endl;
+        if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+          heep_mem_transactions->log(LOG_ADD, tag_to_add, 0, index_to_add, way_to_add);
 
-              //write back
-              memory_copy(address_to_replace, (uint32_t *)cache_data, cache_block_size_word, true, trans, delay);
-            }
+        //only a dirty victim has to be written back
+        if (cache->is_entry_valid_at(index_to_add, way_to_add) && cache->is_entry_dirty_at(index_to_add, way_to_add)) {
+          cache->get_data_at(index_to_add, way_to_add, cache_data);
+          address_to_replace = cache->get_address_at(index_to_add, way_to_add);
 
-            //now replace the entry in cache
-            cache->add_entry(addr_i, (uint8_t*)main_mem_data);
+          if (heep_mem_transactions->enabled(LOG_LEVEL_EVENTS))
+            heep_mem_transactions->log(LOG_REPLACE, addr, address_to_replace, index_to_add, cache->get_tag(address_to_replace));
 
-            //if Write, writes to cache
-            if(we_i)
-              cache->set_word(addr_i, rwdata_io);
+          //write back
+          cache_stat.writebacks++;
+          memory_copy(address_to_replace, (int32_t *)cache_data, cache_block_size_word, true, trans, delay);
+        }
 
-            //now give back the rdata
-            rwdata_io = main_mem_data[addr_offset>>2]; //>>2 as addr_offset is for byte address, not words
+        //now replace the entry in cache
+        cache->add_entry(addr, way_to_add, (uint8_t*)main_mem_data);
 
-            //wait some time before giving the rvalid
-            wait(delay_rvalid_miss);
+        //if Write, writes to cache, otherwise gives back the rdata
+        if(we)
+          cache->set_word(addr, way_to_add, rwdata);
+        else
+          rwdata = main_mem_data[addr_offset>>2]; //>>2 as addr_offset is for byte address, not words
 
-          }
-        }
+        //the response is given once the line fill (and the write back) burst is done
+        latency = main_memory_latency(now, miss_latency, delay);
       }
+    }
 
-      heep_mem_transactions << "X-HEEP tlm_generic_payload RESP: { DATA = 0x" << hex << rwdata_io <<", at time " << sc_time_stamp() << " }" << std::endl;
-      cache->print_cache_status(cache_stat.number_of_transactions++, sc_time_stamp().to_string());
+    if (heep_mem_transactions->enabled(LOG_LEVEL_OBI))
+      heep_mem_transactions->log(LOG_RESP, addr, rwdata);
+    if (heep_mem_transactions->enabled(LOG_LEVEL_STATUS))
+      cache->print_cache_status(cache_stat.number_of_transactions, sc_time_stamp().to_string());
+    cache_stat.number_of_transactions++;
 
-      obi_new_rvalid.notify();
+    return latency;
+  }
 
-    }
+  // Latency of a request that uses the main memory for delay after the given controller latency:
+  // the memory transactions start when the ones of the previous request are done
+  sc_time main_memory_latency(const sc_time& now, const sc_time& controller_latency, const sc_time& delay)
+  {
+    if (delay == SC_ZERO_TIME) return controller_latency;
+    sc_time start = main_memory_free > now ? main_memory_free : now;
+    main_memory_free = start + delay;
+    return main_memory_free + controller_latency - now;
   }
 };
 
@@ -0,0 +1,186 @@
+#ifndef TRANSACTIONLOG_H
+#define TRANSACTIONLOG_H
+
+#include "systemc"
+using namespace sc_core;
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Binary log of the transactions of the SystemC external memory.
+// Records are appended to a buffer in memory, full buffers are written to the
+// file by a background thread while the simulation fills the other buffer.
+// util/systemc_log.py renders the log as text.
+
+// what is logged, selected with +systemc_log_level
+enum log_level_t {
+  LOG_LEVEL_OFF    = 0,
+  LOG_LEVEL_OBI    = 1, // OBI requests and responses
+  LOG_LEVEL_EVENTS = 2, // plus cache hits, misses, replacements and main memory words
+  LOG_LEVEL_STATUS = 3  // plus the whole cache content after every request, in cache_status.log
+};
+
+// keep in sync with util/systemc_log.py
+enum log_record_type_t {
+  LOG_REQ          = 0,  // a: address, b: data, c: byte enable, d: write enable
+  LOG_RESP         = 1,  // b: data
+  LOG_FLUSH        = 2,  // flush requested by the configuration register
+  LOG_FLUSHED      = 3,  // c: number of lines written back
+  LOG_BYPASS_SET   = 4,  // bypass requested by the configuration register
+  LOG_BYPASS       = 5,  // request served in bypass state
+  LOG_HIT          = 6,  // a: address
+  LOG_MISS         = 7,  // a: address
+  LOG_ADD          = 8,  // a: tag, c: index, d: way
+  LOG_REPLACE      = 9,  // a: address, b: replaced address, c: index, d: replaced tag
+  LOG_MEM_READ     = 10, // a: memory address, b: data, d: 1 in bypass state
+  LOG_MEM_WRITE    = 11  // a: memory address, b: data, d: 1 in bypass state
+};
+
+class TransactionLog
+{
+
+  public:
+    typedef struct log_record {
+      uint64_t time;  // in units of the SystemC time resolution
+      uint32_t type;
+      uint32_t a;
+      uint32_t b;
+      uint32_t c;
+      uint32_t d;
+      uint32_t reserved;
+    } log_record_t;
+
+    // 8 bytes of magic, the version and the time resolution in fs
+    typedef struct log_header {
+      char     magic[8];
+      uint32_t version;
+      uint32_t record_size;
+      uint64_t resolution_fs;
+    } log_header_t;
+
+    static const unsigned int BUFFER_RECORDS = 64*1024;
+
+    TransactionLog() : level(LOG_LEVEL_OFF), file(NULL), used(0), pending(NULL), pending_records(0), stop(false) {}
+
+    ~TransactionLog()
+    {
+      close();
+    }
+
+    bool open(const std::string& file_name, log_level_t log_level)
+    {
+      close();
+      level = log_level;
+      if (level == LOG_LEVEL_OFF) return true;
+
+      file = fopen(file_name.c_str(), "wb");
+      if (file == NULL) {
+        level = LOG_LEVEL_OFF;
+        return false;
+      }
+
+      log_header_t header;
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, "XHEEPLOG", 8);
+      header.version       = 1;
+      header.record_size   = sizeof(log_record_t);
+      header.resolution_fs = (uint64_t)(sc_get_time_resolution().to_seconds() * 1e15 + 0.5);
+      fwrite(&header, sizeof(header), 1, file);
+
+      active  = buffers[0];
+      used    = 0;
+      pending = NULL;
+      stop    = false;
+      writer  = std::thread(&TransactionLog::writer_thread, this);
+      return true;
+    }
+
+    // writes the records still in memory and waits for the background thread
+    void close()
+    {
+      if (file == NULL) return;
+      submit();
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        stop = true;
+      }
+      cond.notify_all();
+      writer.join();
+      fclose(file);
+      file  = NULL;
+      level = LOG_LEVEL_OFF;
+    }
+
+    bool enabled(log_level_t log_level) const
+    {
+      return level >= log_level;
+    }
+
+    void log(log_record_type_t type, uint32_t a, uint32_t b = 0, uint32_t c = 0, uint32_t d = 0)
+    {
+      if (used == BUFFER_RECORDS) submit();
+      log_record_t& record = active[used++];
+      record.time     = sc_time_stamp().value();
+      record.type     = type;
+      record.a        = a;
+      record.b        = b;
+      record.c        = c;
+      record.d        = d;
+      record.reserved = 0;
+    }
+
+    log_level_t level;
+
+  private:
+    // hands the active buffer to the writer and continues on the other one
+    void submit()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [this] { return pending == NULL; });
+      if (used == 0) return;
+      pending         = active;
+      pending_records = used;
+      active          = active == buffers[0] ? buffers[1] : buffers[0];
+      used            = 0;
+      cond.notify_all();
+    }
+
+    void writer_thread()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        cond.wait(lock, [this] { return pending != NULL || stop; });
+        if (pending != NULL) {
+          log_record_t* records = pending;
+          size_t        n       = pending_records;
+          // the simulation keeps filling the other buffer while this one is written
+          lock.unlock();
+          fwrite(records, sizeof(log_record_t), n, file);
+          lock.lock();
+          pending = NULL;
+          cond.notify_all();
+        } else if (stop) {
+          return;
+        }
+      }
+    }
+
+    FILE*                   file;
+    log_record_t            buffers[2][BUFFER_RECORDS];
+    log_record_t*           active;
+    size_t                  used;
+    log_record_t*           pending;
+    size_t                  pending_records;
+    bool                    stop;
+    std::thread             writer;
+    std::mutex              mutex;
+    std::condition_variable cond;
+
+};
+
+#endif
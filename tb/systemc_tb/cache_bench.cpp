@@ -0,0 +1,48 @@
+// Copyright 2024 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+// Microbenchmark of the CacheMemory access path, without SystemC:
+//   g++ -O2 -I tb tb/systemc_tb/cache_bench.cpp -o cache_bench && ./cache_bench [sets] [ways] [line_size]
+// The working set fits in the cache, so after the first pass every access is a hit.
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "systemc_tb/Cache.h"
+
+int main(int argc, char* argv[])
+{
+  uint32_t sets      = argc > 1 ? atoi(argv[1]) : 256;
+  uint32_t ways      = argc > 2 ? atoi(argv[2]) : 1;
+  uint32_t line_size = argc > 3 ? atoi(argv[3]) : 16;
+  const uint64_t naccesses = 20000000;
+
+  CacheMemory cache;
+  if (!cache.create_cache(sets, ways, line_size, CacheMemory::REPLACEMENT_LRU)) return EXIT_FAILURE;
+  cache.initialize_cache();
+
+  std::vector<uint8_t> line(line_size, 0);
+  std::vector<uint32_t> addresses(4096);
+  for (size_t i = 0; i < addresses.size(); i++) addresses[i] = (rand() % cache.cache_size_byte) & ~3u;
+
+  int32_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < naccesses; i++) {
+    uint32_t address = addresses[i % addresses.size()];
+    if (!cache.cache_hit(address)) cache.add_entry(address, cache.get_victim_way(address), line.data());
+    // one write every four accesses, as a load/store mix
+    if ((i & 3) == 3) cache.set_word(address, (int32_t)i);
+    else checksum += cache.get_word(address);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  printf("%u sets, %u ways, %u bytes per line: %.2f M accesses/s (checksum %d)\n",
+         sets, ways, line_size, naccesses / elapsed.count() / 1e6, checksum);
+  return EXIT_SUCCESS;
+}
@@ -9,12 +9,12 @@
 #include "systemc.h"
 #include <stdlib.h>
 #include <iostream>
+#include <deque>
+#include <chrono>
 #include "XHEEP_CmdLineOptions.hh"
+#include "XHEEP_FirmwareLoader.hh"
 
 sc_event reset_done_event;
-sc_event obi_new_gnt;
-sc_event obi_new_rvalid;
-sc_event obi_new_req;
 
 
 #include "systemc_tb/MemoryRequest.h"
@@ -38,32 +38,50 @@ SC_MODULE(external_memory)
   sc_out<bool>         ext_systemc_resp_rvalid_o;
   sc_out<uint32_t>     ext_systemc_resp_rdata_o;
 
-  void notify_obi_transaction () {
-    if(ext_systemc_req_req_i) {
-      obi_new_req.notify();
-      memory_request->we_i    = ext_systemc_req_we_i;
-      memory_request->be_i    = ext_systemc_req_be_i;
-      memory_request->addr_i  = ext_systemc_req_addr_i;
-      memory_request->rwdata_io = ext_systemc_req_wdata_i;
-    }
-  }
+  // OBI slave with up to max_outstanding requests waiting for their response:
+  // the gnt is given in the same cycle as the req while there is room, the
+  // responses are given in order, once their latency has elapsed
+  typedef struct obi_response {
+    uint32_t rdata;
+    sc_time  ready;
+  } obi_response_t;
 
-  void give_gnt_back () {
-    while (true) {
-      ext_systemc_resp_gnt_o.write(false);
-      wait(obi_new_gnt);
-      ext_systemc_resp_gnt_o.write(true);
-      wait();
-    }
+  unsigned int               max_outstanding = 4;
+  std::deque<obi_response_t> responses;
+  sc_signal<bool>            accepting;
+
+  void give_gnt () {
+    ext_systemc_resp_gnt_o.write(ext_systemc_req_req_i.read() && accepting.read());
   }
 
-  void give_rvalid_rdata_back () {
+  void obi_slave () {
+    accepting.write(true);
     while (true) {
-      ext_systemc_resp_rvalid_o.write(false);
-      wait(obi_new_rvalid);
-      ext_systemc_resp_rvalid_o.write(true);
-      ext_systemc_resp_rdata_o.write(memory_request->rwdata_io);
       wait();
+      sc_time now = sc_time_stamp();
+
+      if (!responses.empty() && responses.front().ready <= now) {
+        ext_systemc_resp_rvalid_o.write(true);
+        ext_systemc_resp_rdata_o.write(responses.front().rdata);
+        responses.pop_front();
+      } else {
+        ext_systemc_resp_rvalid_o.write(false);
+      }
+
+      // req and gnt sampled at this edge: the request is accepted
+      if (ext_systemc_req_req_i.read() && ext_systemc_resp_gnt_o.read()) {
+        obi_response_t response;
+        response.rdata = ext_systemc_req_wdata_i.read();
+        response.ready = now + memory_request->serve_request(ext_systemc_req_we_i.read(), ext_systemc_req_be_i.read(),
+                                                             ext_systemc_req_addr_i.read(), response.rdata);
+        // responses are in order
+        if (!responses.empty() && response.ready < responses.back().ready)
+          response.ready = responses.back().ready;
+        memory_request->cache_stat.latency((response.ready - now).to_seconds() * 1e9);
+        responses.push_back(response);
+      }
+
+      accepting.write(responses.size() < max_outstanding);
     }
   }
 
@@ -73,14 +91,14 @@ SC_MODULE(external_memory)
     memory_request = new MemoryRequest("memory_request");
     memory         = new MainMemory   ("main_memory");
 
-    SC_METHOD(notify_obi_transaction);
-    sensitive << ext_systemc_req_req_i;
+    SC_METHOD(give_gnt);
+    sensitive << ext_systemc_req_req_i << accepting;
 
-    SC_CTHREAD(give_gnt_back, clk_i.pos());
-    SC_CTHREAD(give_rvalid_rdata_back, clk_i.pos());
+    SC_CTHREAD(obi_slave, clk_i.pos());
 
     // Bind memory_request socket to target socket
     memory_request->socket.bind( memory->socket );
+    memory_request->dmi_beat_latency = memory->beat_latency;
   }
 };
 
@@ -97,6 +115,7 @@ SC_MODULE(testbench)
   sc_out<bool> jtag_tms_o;
   sc_out<bool> jtag_trst_n_o;
   sc_out<bool> jtag_tdi_o;
+  sc_in<bool>  exit_valid_i;
 
   Vtestharness* dut;
   std::string* firmware;
@@ -104,6 +123,12 @@ SC_MODULE(testbench)
   bool boot_select_option;
   unsigned int reset_cycles = 30;
 
+  // tohost-style exit, as in tb_top: the firmware writes (exit_value << 1) | 1 to the tohost symbol of the ELF
+  bool tohost_enabled = false;
+  uint32_t tohost_addr;
+  bool tohost_exit_valid = false;
+  uint32_t tohost_exit_value;
+
   void make_clock () {
     while(1) {
       clk_o.write(false);
@@ -136,7 +161,42 @@ SC_MODULE(testbench)
 
   void load_firmware () {
     wait();
-    dut->tb_loadHEX(firmware->c_str());
+    XHEEP_FirmwareLoader firmware_loader;
+    if(!firmware_loader.load(*firmware)) exit(EXIT_FAILURE);
+    unsigned int nwords = firmware_loader.write([this](uint32_t addr, uint32_t word) {
+      int written;
+      dut->tb_writeWord(addr, word, &written);
+      return written != 0;
+    });
+    std::cout<<"[TESTBENCH]: Loaded "<<nwords<<" words"<<std::endl;
+    tohost_enabled = firmware_loader.get_symbol_address("tohost", tohost_addr);
+    if(tohost_enabled) std::cout<<"[TESTBENCH]: Exit status also taken from tohost at 0x"<<std::hex<<tohost_addr<<std::dec<<std::endl;
+  }
+
+  // the simulation runs until one of these stops it
+  void stop_on_exit () {
+    if (exit_valid_i.read()) sc_stop();
+  }
+
+  void stop_on_tohost () {
+    int instr_req, instr_addr, data_req, data_we, data_addr, data_wdata;
+    while (true) {
+      wait();
+      if (!tohost_enabled) continue;
+      dut->tb_get_obi_status(&instr_req, &instr_addr, &data_req, &data_we, &data_addr, &data_wdata);
+      if (data_req && data_we && (uint32_t)data_addr == tohost_addr && (data_wdata & 1)) {
+        tohost_exit_valid = true;
+        tohost_exit_value = (uint32_t)data_wdata >> 1;
+        sc_stop();
+      }
+    }
+  }
+
+  void stop_on_finish () {
+    while (true) {
+      for (int i = 0; i < 1024; i++) wait();
+      if (Verilated::gotFinish()) sc_stop();
+    }
   }
 
   void set_exit_loop () {
@@ -173,6 +233,12 @@ SC_MODULE(testbench)
 
     SC_CTHREAD(make_clock, clk_i.pos());
     SC_CTHREAD(make_stimuli, clk_i.pos());
+    SC_CTHREAD(stop_on_finish, clk_i.pos());
+    SC_CTHREAD(stop_on_tohost, clk_i.pos());
+
+    SC_METHOD(stop_on_exit);
+    sensitive << exit_valid_i;
+    dont_initialize();
 
   }
 
@@ -187,6 +253,11 @@ int sc_main (int argc, char * argv[])
   unsigned int max_sim_time, boot_sel, exit_val;
   bool use_openocd;
   bool run_all = false;
+  bool step_loop;
+  trace_mode_t trace_mode;
+  cache_config_t cache_config;
+  ext_mem_config_t ext_mem_config;
+  unsigned int systemc_log_level;
   Verilated::commandArgs(argc, argv);
   Verilated::traceEverOn(true);
 
@@ -202,8 +273,17 @@ int sc_main (int argc, char * argv[])
 
   max_sim_time = cmd_lines_options->get_max_sim_time(run_all);
 
+  trace_mode   = cmd_lines_options->get_trace_mode();
+
+  // the original loop, stepping 1ns at a time and flushing the waveform at every step
+  step_loop    = cmd_lines_options->hasCmdFlag(argc, argv, "+sc_step_loop");
+
   boot_sel     = cmd_lines_options->get_boot_sel();
 
+  cmd_lines_options->get_cache_config(cache_config);
+  cmd_lines_options->get_ext_mem_config(ext_mem_config);
+  systemc_log_level = cmd_lines_options->get_systemc_log_level();
+
   if(use_openocd) {
     std::cout<<"[TESTBENCH]: ERROR: Executing from OpenOCD in SystemC is not supported (yet) in X-HEEP"<<std::endl;
     std::cout<<"exit simulation..."<<std::endl;
@@ -223,6 +303,40 @@ int sc_main (int argc, char * argv[])
   testbench tb("testbench");
   external_memory ext_mem("external_memory");
 
+  if(systemc_log_level > LOG_LEVEL_STATUS) systemc_log_level = LOG_LEVEL_STATUS;
+  if(!ext_mem.memory_request->set_log_level((log_level_t)systemc_log_level))
+    exit(EXIT_FAILURE);
+
+  if(cache_config.stats_region == 0) {
+    std::cout<<"[TESTBENCH]: ERROR: +cache_stats_region must be at least 1 byte"<<std::endl;
+    exit(EXIT_FAILURE);
+  }
+  ext_mem.memory_request->stats_region_size = cache_config.stats_region;
+  if(!ext_mem.memory_request->configure_cache(cache_config.sets, cache_config.ways, cache_config.line_size, cache_config.replacement))
+    exit(EXIT_FAILURE);
+
+  if(!ext_mem.memory->configure(ext_mem_config.size, ext_mem_config.file))
+    exit(EXIT_FAILURE);
+  if(!ext_mem_config.image.empty() && !ext_mem.memory->load_image(ext_mem_config.image))
+    exit(EXIT_FAILURE);
+  ext_mem.memory_request->mem_addr_mask = ext_mem_config.size - 1;
+  std::cout<<"[TESTBENCH]: SystemC main memory of "<<ext_mem_config.size<<" bytes";
+  if(!ext_mem_config.file.empty()) std::cout<<" mapped on "<<ext_mem_config.file;
+  std::cout<<std::endl;
+
+  if(cache_config.outstanding == 0) {
+    std::cout<<"[TESTBENCH]: ERROR: +obi_outstanding must be at least 1"<<std::endl;
+    exit(EXIT_FAILURE);
+  }
+  ext_mem.max_outstanding = cache_config.outstanding;
+  ext_mem.memory_request->hit_latency  = sc_time(cache_config.hit_latency, SC_NS);
+  ext_mem.memory_request->miss_latency = sc_time(cache_config.miss_latency, SC_NS);
+  std::cout<<"[TESTBENCH]: SystemC OBI slave with "<<cache_config.outstanding<<" outstanding requests, "<<cache_config.hit_latency
+           <<"ns hit latency, "<<cache_config.miss_latency<<"ns miss latency"<<std::endl;
+
+  ext_mem.memory_request->use_dmi = cache_config.dmi;
+  if(cache_config.dmi) std::cout<<"[TESTBENCH]: SystemC main memory accessed through DMI"<<std::endl;
+
   svSetScope(svGetScopeFromName("TOP.testharness"));
   svScope scope = svGetScope();
   if (!scope) {
@@ -267,6 +381,7 @@ int sc_main (int argc, char * argv[])
   tb.jtag_tms_o(jtag_tms);
   tb.jtag_trst_n_o(jtag_trst_n);
   tb.jtag_tdi_o(jtag_tdi);
+  tb.exit_valid_i(exit_valid);
 
   tb.dut = &dut;
   tb.firmware = &firmware;
@@ -309,27 +424,64 @@ int sc_main (int argc, char * argv[])
 
 
   VerilatedVcdSc* tfp = nullptr;
-  tfp = new VerilatedVcdSc;
-  dut.trace(tfp, 99);  // Trace 99 levels of hierarchy
-  tfp->open("waveform.vcd");
-
-  // Simulate until $finish
-  while (!Verilated::gotFinish() && exit_valid !=1 ) {
-      // Flush the wave files each cycle so we can immediately see the output
-      // Don't do this in "real" programs, do it in an abort() handler instead
-      if (tfp) tfp->flush();
-      // Simulate 1ns
-      sc_start(1, SC_NS);
+  if (trace_mode != TRACE_OFF) {
+    if (trace_mode != TRACE_FST)
+      std::cout<<"[TESTBENCH]: The SystemC testbench only dumps the whole simulation in waveform.vcd"<<std::endl;
+    tfp = new VerilatedVcdSc;
+    dut.trace(tfp, 99);  // Trace 99 levels of hierarchy
+    tfp->open("waveform.vcd");
+  }
+
+  // +max_sim_time counts clock edges, i.e. half periods, like in tb_top
+  sc_time max_time = clock_sig.period() * ((double)max_sim_time / 2);
+  auto wall_start = std::chrono::steady_clock::now();
+
+  if (step_loop) {
+    // Simulate until $finish
+    while (!Verilated::gotFinish() && exit_valid !=1 && !tb.tohost_exit_valid && (run_all || sc_time_stamp() < max_time)) {
+        // Flush the wave files each cycle so we can immediately see the output
+        if (tfp) tfp->flush();
+        // Simulate 1ns
+        sc_start(1, SC_NS);
+    }
+  } else {
+    // the kernel runs until exit_valid, tohost or $finish call sc_stop
+    if (run_all) sc_start();
+    else sc_start(max_time);
   }
 
+  std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - wall_start;
+  double run_cycles = sc_time_stamp() / clock_sig.period();
+  std::cout<<"[TESTBENCH]: Simulated "<<(uint64_t)run_cycles<<" cycles in "<<wall_time.count()<<" s ("
+           <<(wall_time.count() > 0 ? run_cycles/wall_time.count()/1000.0 : 0)<<" kHz) with the "
+           <<(step_loop ? "step" : "event")<<" loop"<<std::endl;
+
   if(exit_valid == 1) {
     std::cout<<"Program Finished with value "<< exit_value <<std::endl;
     exit_val = EXIT_SUCCESS;
+  } else if(tb.tohost_exit_valid) {
+    std::cout<<"Program Finished with value "<< tb.tohost_exit_value <<std::endl;
+    exit_val = EXIT_SUCCESS;
   } else exit_val = EXIT_FAILURE;
 
   // Final model cleanup
   dut.final();
 
+  CacheStatistics& cache_stat = ext_mem.memory_request->cache_stat;
+  cache_stat.write_json("cache_stats.json");
+  std::cout<<"[TESTBENCH]: SystemC cache: "<<cache_stat.number_of_hit<<" hits, "<<cache_stat.number_of_miss<<" misses ("
+           <<cache_stat.compulsory_misses<<" compulsory, "<<cache_stat.capacity_misses<<" capacity, "<<cache_stat.conflict_misses
+           <<" conflict), "<<cache_stat.writebacks<<" writebacks, statistics in cache_stats.json"<<std::endl;
+
+  // the dirty lines still in the cache are written back first
+  if(!ext_mem_config.dump.empty() || !ext_mem_config.file.empty())
+    ext_mem.memory_request->write_back_cache();
+  if(!ext_mem_config.dump.empty())
+    ext_mem.memory->dump(ext_mem_config.dump);
+
+  // writes the transactions still buffered
+  ext_mem.memory_request->heep_mem_transactions->close();
+
   // Close trace if opened
   if (tfp) {
       tfp->close();
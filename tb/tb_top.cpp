@@ -9,51 +9,267 @@
 
 #include <stdlib.h>
 #include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
 
 #include "XHEEP_CmdLineOptions.hh"
+#include "XHEEP_FirmwareLoader.hh"
+#include "XHEEP_Profiler.hh"
+
+#ifdef TB_SAVABLE
+#include "verilated_save.h"
+#endif
 
 vluint64_t sim_time = 0;
 
+// waveform dump window in sim_time units (two per clock cycle)
+vluint64_t trace_start_time = 0;
+vluint64_t trace_stop_time  = 0;
+
+// trigger-based tracing, armed until one of the trigger conditions is hit
+trace_trigger_t trace_trigger;
+bool trace_armed = false;
+
+typedef struct obi_status {
+  vluint64_t cycle;
+  int instr_req, instr_addr;
+  int data_req, data_we, data_addr, data_wdata;
+} obi_status_t;
+
+// ring buffer with the last trace_trigger.history cycles of bus state
+std::vector<obi_status_t> trace_history;
+unsigned int trace_history_idx = 0;
+vluint64_t trace_history_count = 0;
+
+void writeTraceHistory(){
+  std::ofstream history_file("trace_history.log");
+  unsigned int entries = trace_history_count < trace_history.size() ? trace_history_count : trace_history.size();
+  unsigned int idx = (trace_history_idx + trace_history.size() - entries) % trace_history.size();
+
+  history_file<<"CYCLE | INSTR_REQ INSTR_ADDR | DATA_REQ WE DATA_ADDR DATA_WDATA"<<std::endl;
+  for(unsigned int i = 0; i < entries; i++) {
+    obi_status_t& s = trace_history[idx];
+    history_file<<std::dec<<s.cycle<<" | "<<s.instr_req<<" 0x"<<std::hex<<std::setw(8)<<std::setfill('0')<<(uint32_t)s.instr_addr
+                <<" | "<<s.data_req<<" "<<s.data_we<<" 0x"<<std::setw(8)<<(uint32_t)s.data_addr
+                <<" 0x"<<std::setw(8)<<(uint32_t)s.data_wdata<<std::setfill(' ')<<"\n";
+    idx = (idx + 1) % trace_history.size();
+  }
+  std::cout<<"[TESTBENCH]: Wrote the last "<<std::dec<<entries<<" cycles of bus state in trace_history.log"<<std::endl;
+}
+
+// tohost-style exit: the firmware writes (exit_value << 1) | 1 to the tohost symbol of the ELF
+bool tohost_enabled = false;
+uint32_t tohost_addr;
+bool tohost_exit_valid = false;
+uint32_t tohost_exit_value;
+
+void checkTraceTrigger(Vtestharness *dut, obi_status_t& s){
+  bool hit;
+
+  if(!trace_history.empty()) {
+    trace_history[trace_history_idx] = s;
+    trace_history_idx = (trace_history_idx + 1) % trace_history.size();
+    trace_history_count++;
+  }
+
+  hit = (trace_trigger.on_pc   && s.instr_req && (uint32_t)s.instr_addr == trace_trigger.pc)  ||
+        (trace_trigger.on_addr && s.data_req  && (uint32_t)s.data_addr  == trace_trigger.addr) ||
+        (trace_trigger.on_exit && dut->exit_valid_o == 1);
+
+  if(hit) {
+    std::cout<<"[TESTBENCH]: Trace triggered at cycle "<<s.cycle<<std::endl;
+    trace_armed      = false;
+    trace_start_time = sim_time;
+    trace_stop_time  = trace_trigger.length == 0 ? UINT64_MAX : sim_time + trace_trigger.length*2;
+    if(!trace_history.empty()) writeTraceHistory();
+  }
+}
+
+void checkToHost(obi_status_t& s){
+  if(s.data_req && s.data_we && (uint32_t)s.data_addr == tohost_addr && (s.data_wdata & 1)) {
+    tohost_exit_valid = true;
+    tohost_exit_value = (uint32_t)s.data_wdata >> 1;
+  }
+}
+
+// called on every rising edge while the OBI requests are monitored
+void monitorObi(Vtestharness *dut){
+  obi_status_t s;
+
+  s.cycle = sim_time/2;
+  dut->tb_get_obi_status(&s.instr_req, &s.instr_addr, &s.data_req, &s.data_we, &s.data_addr, &s.data_wdata);
+
+  if(trace_armed) checkTraceTrigger(dut, s);
+  if(tohost_enabled) checkToHost(s);
+}
+
+// PC sampling profiler, NULL when +profile is not given
+XHEEP_Profiler *profiler = NULL;
+
+void profileCycle(Vtestharness *dut){
+  int valid, pc;
+
+  dut->tb_get_retired_pc(&valid, &pc);
+  profiler->cycle(valid != 0, (uint32_t)pc);
+}
+
+void dumpTrace(VerilatedFstC *m_trace){
+  if(m_trace != NULL && sim_time >= trace_start_time && sim_time <= trace_stop_time)
+    m_trace->dump(sim_time);
+}
+
 void runCycles(unsigned int ncycles, Vtestharness *dut, VerilatedFstC *m_trace){
+  if(m_trace == NULL && !trace_armed && !tohost_enabled && profiler == NULL) {
+    for(unsigned int i = 0; i < ncycles; i++) {
+      dut->clk_i ^= 1;
+      dut->eval();
+    }
+    sim_time += ncycles;
+    return;
+  }
   for(unsigned int i = 0; i < ncycles; i++) {
     dut->clk_i ^= 1;
     dut->eval();
-    m_trace->dump(sim_time);
+    if((trace_armed || tohost_enabled) && dut->clk_i) monitorObi(dut);
+    if(profiler != NULL && dut->clk_i) profileCycle(dut);
+    dumpTrace(m_trace);
     sim_time++;
   }
 }
 
+// Runs until exit_valid_o is set (or tohost is written), checking it every check_interval clock cycles
+void runUntilExit(unsigned int check_interval, Vtestharness *dut, VerilatedFstC *m_trace){
+  while(dut->exit_valid_o != 1 && !tohost_exit_valid && !Verilated::gotFinish()) {
+    runCycles(2*check_interval, dut, m_trace);
+  }
+}
+
+// Checkpoints hold the model and the testbench state; firmware_loaded tells whether
+// the firmware has to be loaded after restoring, so that a checkpoint taken after reset
+// can be shared by many firmwares
+bool firmware_loaded = false;
+
+#ifdef TB_SAVABLE
+// uart0 is restored by tb_restore_dpi_handles, the other DPI models must be disabled
+bool checkpointSupported(Vtestharness *dut){
+  int supported;
+  dut->tb_checkpoint_supported(&supported);
+  if(!supported)
+    std::cout<<"[TESTBENCH]: ERROR: checkpoints are not supported with the JTAG DPI (JTAG_DPI=1)"<<std::endl;
+  return supported != 0;
+}
+#endif
+
+bool saveCheckpoint(const std::string& file, Vtestharness *dut){
+#ifdef TB_SAVABLE
+  if(!checkpointSupported(dut)) return false;
+  VerilatedSave os;
+  os.open(file.c_str());
+  os << sim_time << firmware_loaded << tohost_enabled << tohost_addr;
+  os << *dut;
+  os.close();
+  std::cout<<"[TESTBENCH]: Saved checkpoint "<<file<<" at cycle "<<sim_time/2<<std::endl;
+  return true;
+#else
+  std::cout<<"[TESTBENCH]: ERROR: checkpoints need a model built with VERILATOR_SAVABLE=1"<<std::endl;
+  return false;
+#endif
+}
+
+bool restoreCheckpoint(const std::string& file, Vtestharness *dut){
+#ifdef TB_SAVABLE
+  if(!checkpointSupported(dut)) return false;
+  VerilatedRestore os;
+  os.open(file.c_str());
+  os >> sim_time >> firmware_loaded >> tohost_enabled >> tohost_addr;
+  os >> *dut;
+  os.close();
+  dut->tb_restore_dpi_handles();
+  std::cout<<"[TESTBENCH]: Restored checkpoint "<<file<<" at cycle "<<sim_time/2<<std::endl;
+  return true;
+#else
+  std::cout<<"[TESTBENCH]: ERROR: checkpoints need a model built with VERILATOR_SAVABLE=1"<<std::endl;
+  return false;
+#endif
+}
+
 int main (int argc, char * argv[])
 {
 
-  std::string firmware;
-  unsigned int max_sim_time, boot_sel, exit_val;
-  bool use_openocd;
+  std::string firmware, save_checkpoint, restore_checkpoint;
+  uint64_t save_checkpoint_cycle;
+  unsigned int max_sim_time, boot_sel, exit_val, exit_check_interval, threads, profile_period;
+  bool use_openocd, profile_stacks;
   bool run_all = false;
+  trace_mode_t trace_mode;
+  uint64_t trace_start_cycle, trace_stop_cycle;
+  VerilatedFstC *m_trace = NULL;
 
   Verilated::commandArgs(argc, argv);
 
+  XHEEP_CmdLineOptions* cmd_lines_options = new XHEEP_CmdLineOptions(argc,argv);
+
+  threads = cmd_lines_options->get_threads();
+
+  // The thread pool is created with the model, so the number of threads must be set before
+  if(threads != 0) {
+#if defined(VERILATOR_VERSION_INTEGER) && VERILATOR_VERSION_INTEGER >= 5000000
+    Verilated::defaultContextp()->threads(threads);
+#else
+    std::cout<<"[TESTBENCH]: Warning: this Verilator version fixes the number of threads at build time (VERILATOR_THREADS), +threads is ignored"<<std::endl;
+#endif
+  }
+
+  trace_mode = cmd_lines_options->get_trace_mode();
+
+  if(trace_mode == TRACE_WINDOW) {
+    cmd_lines_options->get_trace_window(trace_start_cycle, trace_stop_cycle);
+    trace_start_time = trace_start_cycle < UINT64_MAX/2 ? trace_start_cycle*2 : UINT64_MAX;
+    trace_stop_time  = trace_stop_cycle  < UINT64_MAX/2 ? trace_stop_cycle*2 + 1 : UINT64_MAX;
+  } else if(trace_mode == TRACE_TRIGGER) {
+    cmd_lines_options->get_trace_trigger(trace_trigger);
+    trace_history.resize(trace_trigger.history);
+    trace_armed      = trace_trigger.on_pc || trace_trigger.on_addr || trace_trigger.on_exit || trace_trigger.history != 0;
+    // nothing is dumped until the trigger is hit
+    trace_start_time = UINT64_MAX;
+    trace_stop_time  = UINT64_MAX;
+  } else {
+    trace_start_time = 0;
+    trace_stop_time  = UINT64_MAX;
+  }
+
+  // Only enable tracing when waves are requested, as dumping dominates the simulation time
+  if(trace_mode != TRACE_OFF) Verilated::traceEverOn (true);
+
   // Instantiate the model
   Vtestharness *dut = new Vtestharness;
 
   // Open VCD
-  Verilated::traceEverOn (true);
-  VerilatedFstC *m_trace = new VerilatedFstC;
-  dut->trace (m_trace, 99);
-  m_trace->open ("waveform.vcd");
-
-  XHEEP_CmdLineOptions* cmd_lines_options = new XHEEP_CmdLineOptions(argc,argv);
+  if(trace_mode != TRACE_OFF) {
+    m_trace = new VerilatedFstC;
+    dut->trace (m_trace, 99);
+    m_trace->open ("waveform.vcd");
+  }
 
   use_openocd = cmd_lines_options->get_use_openocd();
   firmware = cmd_lines_options->get_firmware();
 
-  if(firmware.empty() && use_openocd==false){
+  save_checkpoint    = cmd_lines_options->get_save_checkpoint(save_checkpoint_cycle);
+  restore_checkpoint = cmd_lines_options->get_restore_checkpoint();
+
+  if(firmware.empty() && use_openocd==false && restore_checkpoint.empty()){
       std::cout<<"You must specify the firmware if you are not using OpenOCD"<<std::endl;
       exit(EXIT_FAILURE);
   }
 
   max_sim_time = cmd_lines_options->get_max_sim_time(run_all);
 
+  exit_check_interval = cmd_lines_options->get_exit_check_interval();
+
+  profile_period = cmd_lines_options->get_profile_period(profile_stacks);
+
   boot_sel     = cmd_lines_options->get_boot_sel();
 
   if(boot_sel == 1) {
@@ -78,47 +294,114 @@ int main (int argc, char * argv[])
   dut->execute_from_flash_i = 1; //this cause boot_sel cannot be 1 anyway
   dut->boot_select_i        = boot_sel;
 
-  dut->eval();
-  m_trace->dump(sim_time);
-  sim_time++;
+  if(restore_checkpoint.empty()) {
+    dut->eval();
+    dumpTrace(m_trace);
+    sim_time++;
+
+    dut->rst_ni               = 1;
+    //this creates the negedge
+    runCycles(50, dut, m_trace);
+    dut->rst_ni               = 0;
+    runCycles(50, dut, m_trace);
 
-  dut->rst_ni               = 1;
-  //this creates the negedge
-  runCycles(50, dut, m_trace);
-  dut->rst_ni               = 0;
-  runCycles(50, dut, m_trace);
 
+    dut->rst_ni = 1;
+    runCycles(20, dut, m_trace);
+    std::cout<<"Reset Released"<< std::endl;
 
-  dut->rst_ni = 1;
-  runCycles(20, dut, m_trace);
-  std::cout<<"Reset Released"<< std::endl;
+    if(!save_checkpoint.empty() && save_checkpoint_cycle == 0) {
+      if(!saveCheckpoint(save_checkpoint, dut)) exit(EXIT_FAILURE);
+    }
+  } else {
+    if(!restoreCheckpoint(restore_checkpoint, dut)) exit(EXIT_FAILURE);
+  }
+
+  XHEEP_FirmwareLoader firmware_loader;
 
   //dont need to exit from boot loop if using OpenOCD or Boot from Flash
-  if(use_openocd==false || boot_sel == 1) {
-    dut->tb_loadHEX(firmware.c_str());
+  if(firmware_loaded) {
+    std::cout<<"Firmware already loaded in the checkpoint"<< std::endl;
+    // the firmware is only parsed for its symbols
+    if(!firmware.empty() && !firmware_loader.load(firmware)) exit(EXIT_FAILURE);
+  } else if(use_openocd==false || boot_sel == 1) {
+    if(firmware.empty()) {
+      std::cout<<"You must specify the firmware if the checkpoint was saved before loading it"<<std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if(!firmware_loader.load(firmware)) exit(EXIT_FAILURE);
+    unsigned int nwords = firmware_loader.write([dut](uint32_t addr, uint32_t word) {
+      int written;
+      dut->tb_writeWord(addr, word, &written);
+      return written != 0;
+    });
+    std::cout<<"[TESTBENCH]: Loaded "<<nwords<<" words"<<std::endl;
+    tohost_enabled = firmware_loader.get_symbol_address("tohost", tohost_addr);
+    if(tohost_enabled) std::cout<<"[TESTBENCH]: Exit status also taken from tohost at 0x"<<std::hex<<tohost_addr<<std::dec<<std::endl;
     runCycles(1, dut, m_trace);
     dut->tb_set_exit_loop();
     std::cout<<"Set Exit Loop"<< std::endl;
     runCycles(1, dut, m_trace);
     std::cout<<"Memory Loaded"<< std::endl;
+    firmware_loaded = true;
   } else {
     std::cout<<"Waiting for GDB"<< std::endl;
   }
 
+  // the profile starts after the firmware load, so that reset and boot are not sampled
+  if(profile_period != 0) {
+    profiler = new XHEEP_Profiler(profile_period, profile_stacks);
+    profiler->set_symbols(firmware_loader.symbols);
+  }
+
+  vluint64_t run_start_time = sim_time;
+  auto wall_start = std::chrono::steady_clock::now();
+
+  if(!save_checkpoint.empty() && save_checkpoint_cycle != 0) {
+    // run up to the checkpoint cycle, save it and carry on
+    while(sim_time/2 < save_checkpoint_cycle && dut->exit_valid_o != 1 && !tohost_exit_valid && !Verilated::gotFinish() &&
+          (run_all || sim_time - run_start_time < max_sim_time)) {
+      runCycles(2, dut, m_trace);
+    }
+    if(sim_time/2 >= save_checkpoint_cycle) {
+      if(!saveCheckpoint(save_checkpoint, dut)) exit(EXIT_FAILURE);
+    }
+  }
+
   if(run_all==false) {
-    runCycles(max_sim_time, dut, m_trace);
+    if(sim_time - run_start_time < max_sim_time) runCycles(max_sim_time - (sim_time - run_start_time), dut, m_trace);
   } else {
-    while(dut->exit_valid_o!=1) {
-      runCycles(500, dut, m_trace);
-    }
+    runUntilExit(exit_check_interval, dut, m_trace);
   }
 
+  std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - wall_start;
+  vluint64_t run_cycles = (sim_time - run_start_time)/2;
+  std::cout<<"[TESTBENCH]: Simulated "<<run_cycles<<" cycles in "<<wall_time.count()<<" s ("
+           <<(wall_time.count() > 0 ? run_cycles/wall_time.count()/1000.0 : 0)<<" kHz)"<<std::endl;
+
   if(dut->exit_valid_o==1) {
     std::cout<<"Program Finished with value "<<dut->exit_value_o<<std::endl;
     exit_val = EXIT_SUCCESS;
+  } else if(tohost_exit_valid) {
+    std::cout<<"Program Finished with value "<<tohost_exit_value<<std::endl;
+    exit_val = EXIT_SUCCESS;
   } else exit_val = EXIT_FAILURE;
 
-  m_trace->close();
+  if(trace_armed && !trace_history.empty()) writeTraceHistory();
+
+  if(profiler != NULL) {
+    profiler->write_profile("profile.txt");
+    profiler->write_folded("profile.folded");
+    delete profiler;
+  }
+
+  // runs the SystemVerilog final blocks (e.g. the bus statistics)
+  dut->final();
+
+  if(m_trace != NULL) {
+    m_trace->close();
+    delete m_trace;
+  }
   delete dut;
   delete cmd_lines_options;
 
@@ -9,8 +9,15 @@ export "DPI-C" task tb_loadHEX;
 % for bank in xheep.iter_ram_banks():
 export "DPI-C" task tb_writetoSram${bank.name()};
 % endfor
+export "DPI-C" task tb_writeWord;
 export "DPI-C" task tb_getMemSize;
 export "DPI-C" task tb_set_exit_loop;
+export "DPI-C" task tb_get_obi_status;
+export "DPI-C" task tb_get_retired_pc;
+`ifdef VERILATOR
+export "DPI-C" task tb_restore_dpi_handles;
+export "DPI-C" task tb_checkpoint_supported;
+`endif
 
 import core_v_mini_mcu_pkg::*;
 
@@ -104,6 +111,76 @@ endtask
 
 % endfor
 
+// Writes one word at the given byte address into the SRAM bank mapped there,
+// used by the C++ firmware loader of the Verilator testbench
+// written is 0 when addr is not in a RAM bank and the word was dropped
+task tb_writeWord;
+  input int addr;
+  input int val;
+  output int written;
+  int w_addr;
+  written = 0;
+% for bank in xheep.iter_ram_banks():
+  if (addr >= ${bank.start_address()} && addr < ${bank.end_address()} &&
+      ((addr/4) & ${2**bank.il_level()-1}) == ${bank.il_offset()}) begin
+    w_addr = ((addr/4) >> ${bank.il_level()}) % ${bank.size()//4};
+    tb_writetoSram${bank.name()}(w_addr, val[31:24], val[23:16], val[15:8], val[7:0]);
+    written = 1;
+  end
+% endfor
+endtask
+
+// Samples the CPU instruction and data OBI requests, used by the Verilator testbench trace triggers
+task tb_get_obi_status;
+  output int instr_req;
+  output int instr_addr;
+  output int data_req;
+  output int data_we;
+  output int data_addr;
+  output int data_wdata;
+  instr_req  = x_heep_system_i.core_v_mini_mcu_i.core_instr_req.req;
+  instr_addr = x_heep_system_i.core_v_mini_mcu_i.core_instr_req.addr;
+  data_req   = x_heep_system_i.core_v_mini_mcu_i.core_data_req.req;
+  data_we    = x_heep_system_i.core_v_mini_mcu_i.core_data_req.we;
+  data_addr  = x_heep_system_i.core_v_mini_mcu_i.core_data_req.addr;
+  data_wdata = x_heep_system_i.core_v_mini_mcu_i.core_data_req.wdata;
+endtask
+
+// Samples the PC of the instruction in the last pipeline stage of the CPU and whether
+// it retires in this cycle, used by the Verilator testbench profiler
+task tb_get_retired_pc;
+  output int valid;
+  output int pc;
+% if cpu_type == "cv32e20":
+  valid = x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i.gen_cv32e20.cv32e20_i.u_cve2_core.instr_id_done;
+  pc    = x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i.gen_cv32e20.cv32e20_i.u_cve2_core.pc_id;
+% elif cpu_type == "cv32e40x":
+  valid = x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i.gen_cv32e40x.cv32e40x_core_i.wb_valid;
+  pc    = x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i.gen_cv32e40x.cv32e40x_core_i.ex_wb_pipe.pc;
+% else:
+  valid = x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i.gen_${cpu_type}.${cpu_type}_top_i.core_i.instr_valid_id &&
+          x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i.gen_${cpu_type}.${cpu_type}_top_i.core_i.id_valid;
+  pc    = x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i.gen_${cpu_type}.${cpu_type}_top_i.core_i.pc_id;
+% endif
+endtask
+
+`ifdef VERILATOR
+import "DPI-C" function chandle uartdpi_create(input string name, input string log_file_path);
+
+// The host handles restored from a checkpoint belong to the process that saved it,
+// so the DPI contexts are created again
+task tb_restore_dpi_handles;
+  i_uart0.ctx = uartdpi_create("uart0", i_uart0.log_file_path);
+endtask
+
+// The remote bitbang server of SimJTAG keeps its socket and state in C globals,
+// which are neither saved nor restored: no checkpoints when the JTAG DPI is used
+task tb_checkpoint_supported;
+  output int supported;
+  supported = JTAG_DPI == 0;
+endtask
+`endif
+
 task tb_set_exit_loop;
 `ifdef VCS
   force x_heep_system_i.core_v_mini_mcu_i.ao_peripheral_subsystem_i.soc_ctrl_i.testbench_set_exit_loop[0] = 1'b1;
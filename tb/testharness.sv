@@ -659,4 +659,19 @@ module testharness #(
     end
   endgenerate
 
+`ifndef SYNTHESIS
+  // system bus performance counters, enabled with +bus_stats
+  obi_bus_monitor #(
+      .NMASTER(core_v_mini_mcu_pkg::SYSTEM_XBAR_NMASTER + HEEP_EXT_XBAR_NMASTER),
+      .NSLAVE (core_v_mini_mcu_pkg::SYSTEM_XBAR_NSLAVE)
+  ) obi_bus_monitor_i (
+      .clk_i        (x_heep_system_i.core_v_mini_mcu_i.clk_i),
+      .rst_ni       (x_heep_system_i.core_v_mini_mcu_i.rst_ni),
+      .master_req_i (x_heep_system_i.core_v_mini_mcu_i.system_bus_i.master_req),
+      .master_resp_i(x_heep_system_i.core_v_mini_mcu_i.system_bus_i.master_resp),
+      .slave_req_i  (x_heep_system_i.core_v_mini_mcu_i.system_bus_i.int_slave_req),
+      .slave_resp_i (x_heep_system_i.core_v_mini_mcu_i.system_bus_i.int_slave_resp)
+  );
+`endif
+
 endmodule  // testharness
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+# Copyright 2024 EPFL
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+# Renders the binary log frames sent by binlog_flush (sw/device/lib/runtime/binlog.h)
+# in a UART capture, with the format strings read from the .binlog_fmt section of
+# the firmware ELF. The text around the frames (printf) is copied as it is.
+
+import argparse
+import re
+import struct
+import sys
+
+# keep in sync with sw/device/lib/runtime/binlog.h
+FRAME_SYNC = struct.pack("<I", 0x474C42B1)
+FRAME_HEADER = struct.Struct("<III")
+FMT_SECTION = ".binlog_fmt"
+
+SHT_PROGBITS = 1
+SHF_ALLOC = 2
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+class Firmware:
+    """Format strings and loaded data of a 32-bit little-endian ELF."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            elf = f.read()
+        if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+            raise ValueError("not a 32-bit little-endian ELF")
+        shoff, = struct.unpack_from("<I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+        sections = [struct.unpack_from("<IIIIII", elf, shoff + i * shentsize) for i in range(shnum)]
+        names = sections[shstrndx][4]
+
+        self.formats = None
+        self.loaded = []
+        for name, stype, flags, addr, offset, size in sections:
+            name = elf[names + name:elf.index(b"\0", names + name)].decode()
+            if name == FMT_SECTION:
+                self.formats = elf[offset:offset + size]
+            elif stype == SHT_PROGBITS and flags & SHF_ALLOC:
+                self.loaded.append((addr, elf[offset:offset + size]))
+        if self.formats is None:
+            raise ValueError("no {} section, is BINLOG used by the firmware?".format(FMT_SECTION))
+
+    @staticmethod
+    def c_string(data, offset):
+        end = data.find(b"\0", offset)
+        return data[offset:end if end >= 0 else len(data)].decode(errors="replace")
+
+    def format_string(self, fmt_id):
+        if fmt_id >= len(self.formats):
+            return None
+        return self.c_string(self.formats, fmt_id)
+
+    def string_at(self, addr):
+        for start, data in self.loaded:
+            if start <= addr < start + len(data):
+                return self.c_string(data, addr - start)
+        return "<0x{:08x}>".format(addr)
+
+
+def render(firmware, fmt, args):
+    """printf for 32-bit arguments."""
+    args = list(args)
+
+    def conversion(m):
+        flags, width, precision, conv = m.groups()
+        if conv == "%":
+            return "%"
+        if not args:
+            return "<missing>"
+        value = args.pop(0)
+        if conv in "di":
+            value = value - (1 << 32) if value & 0x80000000 else value
+            conv = "d"
+        elif conv == "c":
+            value = chr(value & 0xFF)
+        elif conv == "s":
+            value = firmware.string_at(value)
+        elif conv == "p":
+            return "0x{:08x}".format(value)
+        spec = "%" + flags + width + ("." + precision if precision else "") + conv
+        return spec % value
+
+    return CONVERSION.sub(conversion, fmt)
+
+
+def decode_frame(firmware, words, last_time):
+    """Yields the rendered records of a frame and the timestamp of the last one."""
+    i = 0
+    while i + 2 <= len(words):
+        header, time = words[i], words[i + 1]
+        nargs, fmt_id = header >> 28, header & 0x0FFFFFFF
+        args = words[i + 2:i + 2 + nargs]
+        i += 2 + nargs
+        fmt = firmware.format_string(fmt_id)
+        message = render(firmware, fmt, args) if fmt is not None else "<unknown format {}>".format(fmt_id)
+        delta = "" if last_time is None else "+{}".format((time - last_time) & 0xFFFFFFFF)
+        last_time = time
+        yield "[{:10d} {:>8}] {}".format(time, delta, message.rstrip("\n")), last_time
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="binlog_decode", description="Renders the binary log frames in a UART capture.")
+    parser.add_argument("elf", help="Firmware ELF with the .binlog_fmt section")
+    parser.add_argument("capture", nargs="?", default="uart0.log", help="UART capture (default: uart0.log)")
+    parser.add_argument("--output", "-o", default=None, help="Text file (default: stdout)")
+    parser.add_argument("--no-text", action="store_true", help="Only render the binary log, not the text around it")
+    args = parser.parse_args()
+
+    try:
+        firmware = Firmware(args.elf)
+        with open(args.capture, "rb") as f:
+            capture = f.read()
+    except (OSError, ValueError) as e:
+        print("binlog_decode: {}".format(e), file=sys.stderr)
+        sys.exit(1)
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    last_time = None
+    pos = 0
+    while pos < len(capture):
+        sync = capture.find(FRAME_SYNC, pos)
+        text_end = sync if sync >= 0 else len(capture)
+        if not args.no_text and text_end > pos:
+            out.write(capture[pos:text_end].decode(errors="replace"))
+        if sync < 0:
+            break
+
+        pos = sync + FRAME_HEADER.size
+        if pos > len(capture):
+            print("binlog_decode: truncated frame at byte {}".format(sync), file=sys.stderr)
+            break
+        _, nwords, dropped = FRAME_HEADER.unpack_from(capture, sync)
+        if dropped:
+            out.write("[binlog: {} records dropped]\n".format(dropped))
+        words = struct.unpack_from("<{}I".format(nwords), capture, pos) if pos + 4 * nwords <= len(capture) else ()
+        if len(words) != nwords:
+            print("binlog_decode: truncated frame at byte {}".format(sync), file=sys.stderr)
+            break
+        for line, last_time in decode_frame(firmware, words, last_time):
+            out.write(line + "\n")
+        pos += 4 * nwords
+
+
+if __name__ == "__main__":
+    main()
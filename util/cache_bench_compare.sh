@@ -0,0 +1,37 @@
+#!/usr/bin/bash -e
+
+# Builds tb/systemc_tb/cache_bench.cpp against the SystemC cache model of a
+# previous revision and against the current one, and reports the accesses per
+# second of both on a few cache geometries.
+#
+# Usage (from the X-HEEP root folder):
+#   bash util/cache_bench_compare.sh [BASELINE_REV]
+#
+# BASELINE_REV defaults to HEAD~1; its tb/systemc_tb/Cache.h must provide the
+# create_cache, add_entry, get_victim_way, get_word and set_word used by the bench.
+
+BASELINE_REV=${1:-HEAD~1}
+GEOMETRIES=("256 1 16" "64 4 64" "1024 8 64")
+
+BENCH_DIR=$(pwd)/build/cache_bench
+mkdir -p $BENCH_DIR/baseline/systemc_tb
+
+git show $BASELINE_REV:tb/systemc_tb/Cache.h > $BENCH_DIR/baseline/systemc_tb/Cache.h
+g++ -O2 -I $BENCH_DIR/baseline -I tb tb/systemc_tb/cache_bench.cpp -o $BENCH_DIR/cache_bench_baseline
+g++ -O2 -I tb tb/systemc_tb/cache_bench.cpp -o $BENCH_DIR/cache_bench
+
+# M accesses/s reported by the bench, run in BENCH_DIR where it writes cache_status.log
+RUN(){
+	(cd $BENCH_DIR; $1 $2) | sed 's/.*: \(.*\) M accesses.*/\1/'
+}
+
+printf "%-12s %12s %12s\n" "geometry" "$BASELINE_REV" "current" > $BENCH_DIR/summary.txt
+for GEOMETRY in "${GEOMETRIES[@]}"
+do
+	BASELINE=$(RUN $BENCH_DIR/cache_bench_baseline "$GEOMETRY")
+	CURRENT=$(RUN $BENCH_DIR/cache_bench "$GEOMETRY")
+	printf "%-12s %12s %12s\n" "$(echo $GEOMETRY | tr ' ' 'x')" "$BASELINE" "$CURRENT" >> $BENCH_DIR/summary.txt
+done
+
+echo "M accesses/s (sets x ways x line size)"
+cat $BENCH_DIR/summary.txt
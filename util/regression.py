@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# Copyright 2024 EPFL
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+# Parallel regression runner for the Verilator model.
+#
+# Every application is built once (sequentially, as the sw build folder is
+# shared) and its firmware is copied in its own work directory. The simulations
+# are then run concurrently, each one in its work directory so that
+# waveform.vcd, uart0.log and the testbench output do not collide.
+#
+# The Verilator model must be built beforehand (make verilator-sim).
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+import xml.etree.ElementTree as ET
+from concurrent.futures import ThreadPoolExecutor
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+SIM_DIR = os.path.join(ROOT, "build", "openhwgroup.org_systems_core-v-mini-mcu_0", "sim-verilator")
+APPS_DIR = os.path.join(ROOT, "sw", "applications")
+
+# Applications that will not be simulated, same as util/test_all.sh
+BLACKLIST = ["example_virtual_flash"]
+
+RE_EXIT = re.compile(r"Program Finished with value (\d+)")
+RE_CYCLES = re.compile(r"\[TESTBENCH\]: Simulated (\d+) cycles")
+
+
+def build_app(app, args, app_dir):
+    """Builds app and copies its firmware in app_dir. Returns the build result."""
+    os.makedirs(app_dir, exist_ok=True)
+    start = time.time()
+    with open(os.path.join(app_dir, "build.log"), "w") as log:
+        subprocess.run(["make", "--no-print-directory", "-s", "app-clean"], cwd=ROOT, stdout=log, stderr=subprocess.STDOUT)
+        res = subprocess.run(["make", "--no-print-directory", "-s", "app", "PROJECT=" + app,
+                              "COMPILER=" + args.compiler, "LINKER=" + args.linker],
+                             cwd=ROOT, stdout=log, stderr=subprocess.STDOUT)
+    if res.returncode == 0:
+        for f in ["main.hex", "main.elf"]:
+            src = os.path.join(ROOT, "sw", "build", f)
+            if os.path.exists(src):
+                shutil.copy(src, app_dir)
+    return {"built": res.returncode == 0, "build_time_s": round(time.time() - start, 3)}
+
+
+def simulate_app(app, args, app_dir):
+    """Runs Vtestharness for app inside app_dir. Returns the simulation result."""
+    # The testbench loads the ELF directly, the hex file is only a fallback
+    firmware = os.path.join(app_dir, "main.elf")
+    if not os.path.exists(firmware):
+        firmware = os.path.join(app_dir, "main.hex")
+    cmd = [os.path.join(SIM_DIR, "Vtestharness"), "+firmware=" + firmware] + args.sim_args
+    result = {"status": "fail", "exit_value": None, "cycles": None, "sim_time_s": None}
+    start = time.time()
+    with open(os.path.join(app_dir, "sim.log"), "w") as log:
+        try:
+            subprocess.run(cmd, cwd=app_dir, stdout=log, stderr=subprocess.STDOUT, timeout=args.timeout)
+        except subprocess.TimeoutExpired:
+            result["status"] = "timeout"
+    result["sim_time_s"] = round(time.time() - start, 3)
+
+    with open(os.path.join(app_dir, "sim.log"), errors="replace") as log:
+        out = log.read()
+    m = RE_CYCLES.search(out)
+    if m:
+        result["cycles"] = int(m.group(1))
+    m = RE_EXIT.search(out)
+    if m:
+        result["exit_value"] = int(m.group(1))
+        if result["status"] != "timeout" and result["exit_value"] == 0:
+            result["status"] = "pass"
+    return result
+
+
+def write_junit(results, path):
+    suite = ET.Element("testsuite", name="x-heep-regression", tests=str(len(results)),
+                       failures=str(sum(r["status"] in ["fail", "build_fail"] for r in results)),
+                       errors=str(sum(r["status"] == "timeout" for r in results)),
+                       skipped=str(sum(r["status"] == "skip" for r in results)))
+    for r in results:
+        case = ET.SubElement(suite, "testcase", classname="sw.applications", name=r["app"],
+                             time=str(r["sim_time_s"] or 0))
+        log = os.path.join(r["work_dir"], "build.log" if r["status"] == "build_fail" else "sim.log")
+        if r["status"] == "skip":
+            ET.SubElement(case, "skipped")
+        elif r["status"] == "timeout":
+            ET.SubElement(case, "error", message="timeout after {} s".format(r["sim_time_s"])).text = log
+        elif r["status"] != "pass":
+            ET.SubElement(case, "failure", message="{} (exit value {})".format(r["status"], r["exit_value"])).text = log
+    ET.ElementTree(suite).write(path, encoding="utf-8", xml_declaration=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="regression", description="Builds all the applications and simulates them in parallel with Verilator.")
+    parser.add_argument("--apps", nargs="+", default=None, help="Applications to test (default: all in sw/applications)")
+    parser.add_argument("--jobs", "-j", type=int, default=os.cpu_count(), help="Number of concurrent simulations (default: number of cores)")
+    parser.add_argument("--timeout", type=int, default=240, help="Timeout of each simulation in seconds (default: 240)")
+    parser.add_argument("--compiler", default="gcc", help="Compiler used to build the applications (default: gcc)")
+    parser.add_argument("--linker", default="on_chip", help="Linker used to build the applications (default: on_chip)")
+    parser.add_argument("--workdir", default=os.path.join(ROOT, "build", "regression"), help="Folder with one work directory per application")
+    parser.add_argument("--json", default=None, help="JSON summary (default: <workdir>/summary.json)")
+    parser.add_argument("--junit", default=None, help="JUnit XML summary (default: <workdir>/junit.xml)")
+    parser.add_argument("--sim-args", nargs="*", default=[], help="Extra plusargs given to Vtestharness")
+    args = parser.parse_args()
+
+    if not os.path.exists(os.path.join(SIM_DIR, "Vtestharness")):
+        print("Vtestharness not found in {}, run make verilator-sim first".format(SIM_DIR))
+        sys.exit(2)
+
+    apps = args.apps if args.apps else sorted(os.listdir(APPS_DIR))
+    workdir = os.path.abspath(args.workdir)
+    results = []
+
+    # Builds are sequential as they share sw/build
+    for app in apps:
+        app_dir = os.path.join(workdir, app)
+        shutil.rmtree(app_dir, ignore_errors=True)
+        r = {"app": app, "work_dir": app_dir, "status": "skip", "exit_value": None, "cycles": None, "sim_time_s": None}
+        r.update(build_app(app, args, app_dir))
+        print("[REGRESSION]: built {:40} {}".format(app, "ok" if r["built"] else "FAILED"), flush=True)
+        if not r["built"]:
+            r["status"] = "build_fail"
+        results.append(r)
+
+    to_simulate = [r for r in results if r["built"] and r["app"] not in BLACKLIST]
+
+    def run(r):
+        r.update(simulate_app(r["app"], args, r["work_dir"]))
+        print("[REGRESSION]: simulated {:36} {:8} {:>12} cycles {:>9} s".format(
+            r["app"], r["status"], str(r["cycles"]), r["sim_time_s"]), flush=True)
+
+    start = time.time()
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        list(pool.map(run, to_simulate))
+    total_time = round(time.time() - start, 3)
+
+    with open(args.json or os.path.join(workdir, "summary.json"), "w") as f:
+        json.dump({"jobs": args.jobs, "sim_wall_time_s": total_time, "results": results}, f, indent=2)
+    write_junit(results, args.junit or os.path.join(workdir, "junit.xml"))
+
+    failed = [r for r in results if r["status"] not in ["pass", "skip"]]
+    print("[REGRESSION]: {} passed, {} failed, {} skipped, simulations took {} s with {} jobs".format(
+        sum(r["status"] == "pass" for r in results), len(failed),
+        sum(r["status"] == "skip" for r in results), total_time, args.jobs))
+    for r in failed:
+        print("[REGRESSION]: {:12} {}".format(r["status"], r["app"]))
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# Copyright 2024 EPFL
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+# Renders as text the binary transaction log of the SystemC external memory
+# (heep_mem_transactions.bin), written by tb/systemc_tb/TransactionLog.h.
+
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct("<8sIIQ")
+RECORD = struct.Struct("<QIIIIII")
+
+# keep in sync with log_record_type_t in tb/systemc_tb/TransactionLog.h
+LOG_REQ = 0
+LOG_RESP = 1
+LOG_FLUSH = 2
+LOG_FLUSHED = 3
+LOG_BYPASS_SET = 4
+LOG_BYPASS = 5
+LOG_HIT = 6
+LOG_MISS = 7
+LOG_ADD = 8
+LOG_REPLACE = 9
+LOG_MEM_READ = 10
+LOG_MEM_WRITE = 11
+
+TYPE_NAMES = ["req", "resp", "flush", "flushed", "bypass_set", "bypass", "hit", "miss", "add", "replace", "mem_read", "mem_write"]
+
+
+def format_time(time, resolution_fs):
+    """Formats a time stamp like sc_time::to_string, in the largest unit that keeps it an integer."""
+    fs = time * resolution_fs
+    if fs == 0:
+        return "0 s"
+    for unit, scale in [("s", 10**15), ("ms", 10**12), ("us", 10**9), ("ns", 10**6), ("ps", 10**3)]:
+        if fs % scale == 0:
+            return "{} {}".format(fs // scale, unit)
+    return "{} fs".format(fs)
+
+
+def render(record, resolution_fs):
+    time, rtype, a, b, c, d, _ = record
+    t = format_time(time, resolution_fs)
+    if rtype == LOG_REQ:
+        return "X-HEEP tlm_generic_payload REQ: {{ {}, @0x{:x} , DATA = 0x{:x} BE = {:x}, at time {} }}".format(
+            "W" if d else "R", a, b, c, t)
+    if rtype == LOG_RESP:
+        return "X-HEEP tlm_generic_payload RESP: {{ DATA = 0x{:x}, at time {} }}".format(b, t)
+    if rtype == LOG_FLUSH:
+        return "X-HEEP Flush Cache, at time {} }}\nCache Flushing at time {}".format(t, t)
+    if rtype == LOG_FLUSHED:
+        return "Cache Flushed {} entries".format(c)
+    if rtype == LOG_BYPASS_SET:
+        return "Cache ByPass set at time {}\nX-HEEP Bypass Cache, at time {} }}".format(t, t)
+    if rtype == LOG_BYPASS:
+        return "Cache in bypass state at time {}".format(t)
+    if rtype == LOG_HIT:
+        return "Cache HIT on address {:x} at time {}".format(a, t)
+    if rtype == LOG_MISS:
+        return "Cache MISS on address {:x} at time {}".format(a, t)
+    if rtype == LOG_ADD:
+        return "Adding to Cache TAG {:x} and index {:x} way {}".format(a, c, d)
+    if rtype == LOG_REPLACE:
+        return "Cache Replace address {:x} with address {:x} due to the MISS at time {}\nIndex to replace {:x} Tag to replace {:x}".format(
+            a, b, t, c, d)
+    if rtype in [LOG_MEM_READ, LOG_MEM_WRITE]:
+        what = "Writing to" if rtype == LOG_MEM_WRITE else "Reading from"
+        return "{}{} Mem[{:x}]: {:x} at time {}".format("" if d else "Cache ", what, a, b, t)
+    return "Unknown record type {} at time {}".format(rtype, t)
+
+
+def read_records(f):
+    header = f.read(HEADER.size)
+    if len(header) < HEADER.size:
+        raise ValueError("truncated header")
+    magic, version, record_size, resolution_fs = HEADER.unpack(header)
+    if magic != b"XHEEPLOG" or version != 1 or record_size != RECORD.size:
+        raise ValueError("not a transaction log of the SystemC testbench")
+    while True:
+        data = f.read(RECORD.size * 4096)
+        if not data:
+            return
+        for offset in range(0, len(data) - len(data) % RECORD.size, RECORD.size):
+            yield RECORD.unpack_from(data, offset), resolution_fs
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="systemc_log", description="Renders the binary transaction log of the SystemC testbench as text.")
+    parser.add_argument("log", nargs="?", default="heep_mem_transactions.bin", help="Binary log (default: heep_mem_transactions.bin)")
+    parser.add_argument("--output", "-o", default=None, help="Text file (default: stdout)")
+    parser.add_argument("--types", nargs="+", choices=TYPE_NAMES, default=None, help="Only render these record types")
+    parser.add_argument("--addr", type=lambda x: int(x, 0), nargs=2, metavar=("START", "END"), default=None,
+                        help="Only render the records whose first address is in [START, END)")
+    args = parser.parse_args()
+
+    types = set(TYPE_NAMES.index(t) for t in args.types) if args.types else None
+    out = open(args.output, "w") if args.output else sys.stdout
+
+    try:
+        with open(args.log, "rb") as f:
+            for record, resolution_fs in read_records(f):
+                if types is not None and record[1] not in types:
+                    continue
+                if args.addr is not None and not (args.addr[0] <= record[2] < args.addr[1]):
+                    continue
+                out.write(render(record, resolution_fs) + "\n")
+    except (OSError, ValueError) as e:
+        print("systemc_log: {}: {}".format(args.log, e), file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,46 @@
+#!/usr/bin/bash -e
+
+# Builds the SystemC model and reports the wall-clock time of an application
+# with the event-driven loop of tb_sc_top.cpp (single sc_start) and with the
+# original 1ns step loop (+sc_step_loop).
+#
+# Usage (from the X-HEEP root folder):
+#   bash util/systemc_loop_bench.sh [PROJECT]
+#
+# Defaults to hello_world. SYSTEMC_LIBDIR must point to the SystemC library,
+# as for make verilator-sim-sc.
+
+PROJECT=${1:-hello_world}
+
+SIM_DIR=./build/openhwgroup.org_systems_core-v-mini-mcu_0/sim_sc-verilator
+LOG_DIR=$(pwd)/build/systemc_loop_bench
+
+WHITE="\033[37;1m "
+RED="\033[31;1m "
+RESET="\033[0m"
+
+mkdir -p $LOG_DIR
+
+make app PROJECT=$PROJECT TARGET=systemc
+make verilator-sim-sc > $LOG_DIR/build.log
+
+# Runs the simulation and extracts the wall-clock seconds and the kHz reported by the testbench
+RUN(){
+	(cd $SIM_DIR; ./Vtestharness +firmware=../../../sw/build/main.elf $1) > $LOG_DIR/run_$2.log
+	if ! grep -q "Program Finished with value 0" $LOG_DIR/run_$2.log ; then
+		echo -e "${RED}Simulation with the $2 loop failed, see $LOG_DIR/run_$2.log${RESET}"
+		exit 1
+	fi
+	grep "\[TESTBENCH\]: Simulated" $LOG_DIR/run_$2.log | sed 's/.* in \(.*\) s (\(.*\) kHz).*/\1 \2/'
+}
+
+read EVENT_S EVENT_KHZ <<< $(RUN "" event)
+read STEP_S STEP_KHZ <<< $(RUN "+sc_step_loop" step)
+SPEEDUP=$(echo "scale=2; $STEP_S / $EVENT_S" | bc)
+
+echo -e "${WHITE}$PROJECT on the SystemC model${RESET}"
+printf "%-6s %10s %10s\n" "loop" "seconds" "kHz" > $LOG_DIR/summary.txt
+printf "%-6s %10s %10s\n" "step" "$STEP_S" "$STEP_KHZ" >> $LOG_DIR/summary.txt
+printf "%-6s %10s %10s\n" "event" "$EVENT_S" "$EVENT_KHZ" >> $LOG_DIR/summary.txt
+echo "speedup $SPEEDUP" >> $LOG_DIR/summary.txt
+cat $LOG_DIR/summary.txt
@@ -51,7 +51,7 @@ SIMULATE(){
 			case $SIMULATOR in
 				"verilator")
 					out=$(cd ./build/openhwgroup.org_systems_core-v-mini-mcu_0/sim-verilator; \
-						out=$(./Vtestharness +firmware=../../../sw/build/main.hex); \
+						out=$(./Vtestharness +firmware=../../../sw/build/main.elf); \
 						cd ../../../ ; \
 						echo $out; )
 					if [ "${out: -1}" == "0" ] ; then
@@ -0,0 +1,56 @@
+#!/usr/bin/bash -e
+
+# Builds the Verilator model with different numbers of threads and reports the
+# simulation speed of an application with each of them.
+#
+# Usage (from the X-HEEP root folder):
+#   bash util/verilator_threads_bench.sh [PROJECT] [X_HEEP_CFG] [THREADS...]
+#
+# Defaults to example_matadd_interleaved on configs/example_interleaved.hjson
+# (NtoM bus) with 2, 4 and 8 threads (see VERILATOR_THREADS in the Makefile).
+# The single-threaded model is always built first and used as the reference
+# for the speedup.
+
+PROJECT=${1:-example_matadd_interleaved}
+X_HEEP_CFG=${2:-configs/example_interleaved.hjson}
+shift 2 2>/dev/null || shift $#
+THREADS=${@:-2 4 8}
+
+SIM_DIR=./build/openhwgroup.org_systems_core-v-mini-mcu_0/sim-verilator
+LOG_DIR=$(pwd)/build/threads_bench
+
+WHITE="\033[37;1m "
+RED="\033[31;1m "
+RESET="\033[0m"
+
+mkdir -p $LOG_DIR
+
+make mcu-gen X_HEEP_CFG=$X_HEEP_CFG
+make app PROJECT=$PROJECT
+
+# Runs the simulation and extracts the kHz reported by the testbench
+RUN(){
+	(cd $SIM_DIR; ./Vtestharness +firmware=../../../sw/build/main.elf $1) > $LOG_DIR/run_$2.log
+	if ! grep -q "Program Finished with value 0" $LOG_DIR/run_$2.log ; then
+		echo -e "${RED}Simulation with $2 threads failed, see $LOG_DIR/run_$2.log${RESET}"
+		exit 1
+	fi
+	grep "\[TESTBENCH\]: Simulated" $LOG_DIR/run_$2.log | sed 's/.*(\(.*\) kHz)/\1/'
+}
+
+make verilator-sim VERILATOR_THREADS= > $LOG_DIR/build_st.log
+REF_KHZ=$(RUN "" st)
+
+RESULTS="threads\tkHz\tspeedup\nst\t$REF_KHZ\t1.00\n"
+
+for N in $THREADS
+do
+	echo -e "${WHITE}Building the model with $N threads${RESET}"
+	make verilator-sim VERILATOR_THREADS=$N > $LOG_DIR/build_$N.log
+	KHZ=$(RUN "+threads=$N" $N)
+	SPEEDUP=$(echo "scale=2; $KHZ / $REF_KHZ" | bc)
+	RESULTS="$RESULTS$N\t$KHZ\t$SPEEDUP\n"
+done
+
+echo -e "${WHITE}$PROJECT on $X_HEEP_CFG${RESET}"
+echo -e $RESULTS | column -t | tee $LOG_DIR/summary.txt